@@ -11,8 +11,11 @@
  **/
 
 #include "BluetoothSerial.h"
+#include "codec.h"
 
 #define MAX_MESSAGE_LENGTH 512
+#define BLOCK_SIZE         512 // CGameBTComms::KCompressBlock
+#define BATCH_SIZE         1024 // Frames between two CRC trailers
 
 #if !defined(CONFIG_BT_ENABLED) || !defined(CONFIG_BLUEDROID_ENABLED)
 #error Bluetooth is not enabled! Please run `make menuconfig` to and enable it.
@@ -20,6 +23,9 @@
 
 BluetoothSerial SerialBT;
 
+// Capabilities accepted, 01h = compressed blocks, 02h = CRC, 04h = clock
+static uint8_t device_capabilities = 0;
+
 void setup()
 {
     Serial.begin(115200);
@@ -27,45 +33,336 @@ void setup()
     Serial.printf("GameCommsHub\n\n");
 }
 
+static void handle_frame(char *buffer, unsigned int length)
+{
+    if (buffer[0] & 0x20) // Multicast: bits 0 to 2 select clients 1 to 3
+    {
+        char header = buffer[0];
+
+        for (unsigned int client = 0; client < 3; client += 1)
+        {
+            if (header & (1 << client))
+            {
+                buffer[0] = (header & 0xd8) | (0x02 + client); // Keep the flags
+                handle_frame(buffer, length);
+            }
+        }
+        buffer[0] = header;
+        return;
+    }
+
+    switch (buffer[0] & 0x27) // Strip fragment, channel and delta flags
+    { 
+        case 0x00: // Superseded, discard
+            break;
+        // Message to ..
+        case 0x01: // Host
+        case 0x02: // Client 1
+        case 0x03: // Client 2
+        case 0x04: // Client 3
+        case 0x05: // all
+        {
+            for (unsigned int i = 0; i < length; i += 1)
+            {
+                Serial.printf("%02X ", buffer[i]);
+            }
+            Serial.printf("\n");
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Decompresses a block of protocol 2 frames and handles each of them
+static void handle_block(const char *buffer, unsigned int length)
+{
+    static char  block[BLOCK_SIZE];
+    unsigned int header_size = (buffer[1] & 0x80) ? 3 : 2;
+    int          size;
+
+    size = lz_decompress((const uint8_t *)&buffer[header_size], length - header_size, (uint8_t *)block, sizeof(block));
+    if (size < 0)
+    {
+        Serial.printf("Corrupt compressed block dropped\n");
+        return;
+    }
+
+    for (unsigned int offset = 0; offset < (unsigned int)size;)
+    {
+        unsigned int frame = frame_size(&block[offset], size - offset, device_capabilities);
+
+        if (frame == 0 || offset + frame > (unsigned int)size)
+        {
+            break;
+        }
+        handle_frame(&block[offset], frame);
+        offset += frame;
+    }
+}
+
+static void put_le32(char *buffer, uint32_t value)
+{
+    buffer[0] = (char)(value & 0xff);
+    buffer[1] = (char)((value >> 8) & 0xff);
+    buffer[2] = (char)((value >> 16) & 0xff);
+    buffer[3] = (char)(value >> 24);
+}
+
+// Answers the clock request 00h 05h 'T' t1 with 00h 0Dh 'T' t1 t2 t3,
+// t2 and t3 being the receive and transmit time of the hub in us
+static void answer_clock(const char *buffer, uint32_t received)
+{
+    char answer[19] = { 0x00, 0x0d, 'T' };
+    unsigned int length = 15;
+
+    memcpy(&answer[3], &buffer[3], 4);
+    put_le32(&answer[7], received);
+    put_le32(&answer[11], micros());
+
+    if (device_capabilities & 0x02)
+    {
+        // A batch of its own
+        uint16_t crc = crc16(answer, length);
+
+        answer[length++] = 0x07;
+        answer[length++] = 0x02;
+        answer[length++] = (char)(crc & 0xff);
+        answer[length++] = (char)(crc >> 8);
+    }
+
+    SerialBT.write((const uint8_t *)answer, length);
+}
+
+// Protocol 2 frame or compressed block
+static void dispatch(const char *buffer, unsigned int length)
+{
+    if ((buffer[0] & 0x27) == 0x06)
+    {
+        handle_block(buffer, length);
+    }
+    else if (buffer[0] == 0x00 && length == 7 && buffer[2] == 'T')
+    {
+        answer_clock(buffer, micros());
+    }
+    else
+    {
+        handle_frame((char *)buffer, length);
+    }
+}
+
+// Collects the frames of a batch and handles them once the trailer
+// (07h 02h, CRC-16 little endian) has been checked
+static void handle_checked(const char *buffer, unsigned int length)
+{
+    static char          batch[BATCH_SIZE];
+    static unsigned int  batch_length = 0;
+    static bool          overflow     = false;
+    static unsigned long corrupt      = 0;
+
+    if ((buffer[0] & 0x27) != 0x07)
+    {
+        if (batch_length + length > BATCH_SIZE)
+        {
+            overflow = true;
+        }
+        else
+        {
+            memcpy(&batch[batch_length], buffer, length);
+            batch_length += length;
+        }
+        return;
+    }
+
+    if (! overflow && length == 4 &&
+        crc16(batch, batch_length) == (uint16_t)((uint8_t)buffer[2] | ((uint8_t)buffer[3] << 8)))
+    {
+        for (unsigned int offset = 0; offset < batch_length;)
+        {
+            unsigned int frame = frame_size(&batch[offset], batch_length - offset, device_capabilities);
+
+            if (frame == 0 || offset + frame > batch_length)
+            {
+                break;
+            }
+            dispatch(&batch[offset], frame);
+            offset += frame;
+        }
+    }
+    else
+    {
+        corrupt += 1;
+        Serial.printf("Corrupt batch dropped (%lu so far)\n", corrupt);
+    }
+
+    batch_length = 0;
+    overflow     = false;
+}
+
+static bool is_upgrade(const char *buffer, unsigned int length)
+{
+    // Void frame 00h 02h 'V' 02h 0Ah: protocol 2 follows
+    return length == 5 && buffer[0] == 0x00 && buffer[2] == 'V' && buffer[3] == 0x02;
+}
+
+static void accept_protocol(bool offered, uint8_t accepted)
+{
+    if (offered)
+    {
+        // Accept protocol 2, old devices discard this void frame
+        const char ack[] = { 0x00, 0x03, 'V', 0x02, (char)accepted, '\n' };
+
+        SerialBT.write((const uint8_t *)ack, sizeof(ack));
+        device_capabilities = accepted;
+    }
+}
+
+// Unpacks the registration frame, see SendRegistrationL() in GameBTComms.cpp
+static bool register_frame(const char *buffer, unsigned int length, bool &offered, uint8_t &accepted)
+{
+    const uint8_t *frame = (const uint8_t *)buffer;
+    unsigned int   name;
+    unsigned int   host;
+
+    if (length < 16 || frame[2] != 'R' || frame[3] != 0x01 || frame[length - 1] != '\n')
+    {
+        return false;
+    }
+
+    name = frame[13];
+    if (14 + name >= length - 1)
+    {
+        return false;
+    }
+    host = frame[14 + name];
+    if (15 + name + host != length - 1)
+    {
+        return false;
+    }
+
+    Serial.printf("UID:0x%08X\n", (unsigned int)(frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24)));
+    Serial.printf("DID:%.*s\n", (int)name, &buffer[14]);
+    Serial.printf("NET:%.*s:%u\n", (int)host, &buffer[15 + name], (unsigned int)(frame[11] | (frame[12] << 8)));
+    Serial.printf("PRO:%u:%02X\n", frame[9], frame[10]);
+    Serial.printf("ROL:%c\n", frame[8]);
+
+    offered  = frame[9] >= 2;
+    accepted = frame[10] & 0x07;
+
+    return true;
+}
+
 void loop()
 {
     while (SerialBT.available() > 0)
     {
         static char         buffer[MAX_MESSAGE_LENGTH] = { 0 };
-        static unsigned int index = 0;
-        char                read_byte = SerialBT.read();
+        static unsigned int index      = 0;
+        static bool         registered = false;
+        static bool         offered    = false; // Device sent PRO:2
+        static uint8_t      accepted   = 0;     // Capabilities accepted, see device_capabilities
+        static int          rx_version = 1;     // Protocol read from the device
+        char                read_byte  = SerialBT.read();
 
-        if ((read_byte != '\n') && (index < MAX_MESSAGE_LENGTH - 1))
+        if (index < MAX_MESSAGE_LENGTH - 1)
         {
             buffer[index] = read_byte;
             index += 1;
         }
-        else
+
+        if (! registered && buffer[0] == 0x00)
         {
-            buffer[index] = '\0';
-
-            switch (buffer[0])
-            { 
-                // Message to ..
-                case 0x01: // Host
-                case 0x02: // Client 1
-                case 0x03: // Client 2
-                case 0x04: // Client 3
-                case 0x05: // all
+            // Registration frame: 00h, length, 'R', fields, new line
+            if (index >= 2 && index == (unsigned int)(unsigned char)buffer[1] + 3)
+            {
+                if (! register_frame(buffer, index, offered, accepted))
                 {
-                    for (int i = 0; i < index; i += 1)
+                    index = 0; // Not a registration frame, keep waiting
+                    continue;
+                }
+                registered = true;
+                index      = 0;
+
+                // Accept the registration, then protocol 2 if offered
+                const char ack[] = { 0x00, 0x02, 'R', 0x01, '\n' };
+
+                SerialBT.write((const uint8_t *)ack, sizeof(ack));
+                accept_protocol(offered, accepted);
+            }
+        }
+        else if (! registered)
+        {
+            // Registration sequence: one text line per key
+            if (read_byte == '\n' || index == MAX_MESSAGE_LENGTH - 1)
+            {
+                buffer[index - 1] = '\0';
+                Serial.printf("%s\n", buffer);
+
+                if (strncmp(buffer, "PRO:", 4) == 0 && atoi(&buffer[4]) >= 2)
+                {
+                    const char *capabilities = strchr(&buffer[4], ':');
+
+                    offered = true;
+                    if (capabilities)
                     {
-                        Serial.printf("%02X ", buffer[i]);
+                        accepted = strtol(&capabilities[1], NULL, 16) & 0x07;
                     }
-                    Serial.printf("\n");
-                    buffer[0] = 0x00;
-                    break;
                 }
-                default:
-                    Serial.printf("%s\n", buffer);
-                    break;
+                else if (strncmp(buffer, "ROL:", 4) == 0)
+                {
+                    registered = true;
+                    accept_protocol(offered, accepted);
+                }
+                index = 0;
+            }
+        }
+        else if (rx_version == 1)
+        {
+            if (index >= 2 && index == (unsigned int)(unsigned char)buffer[1] + 3)
+            {
+                // Frame: recipient, length, payload, new line
+                if (buffer[index - 1] == '\n')
+                {
+                    if (is_upgrade(buffer, index))
+                    {
+                        rx_version = 2;
+                    }
+                    else
+                    {
+                        handle_frame(buffer, index);
+                    }
+                    index = 0;
+                }
+                else
+                {
+                    // Out of sync, retry one byte later
+                    memmove(buffer, &buffer[1], index - 1);
+                    index -= 1;
+                }
+            }
+        }
+        else
+        {
+            unsigned int size = frame_size(buffer, index, device_capabilities);
+
+            if (size > MAX_MESSAGE_LENGTH - 1)
+            {
+                // Out of sync, retry one byte later
+                memmove(buffer, &buffer[1], index - 1);
+                index -= 1;
+            }
+            else if (size > 0 && index == size)
+            {
+                if (accepted & 0x02)
+                {
+                    handle_checked(buffer, index);
+                }
+                else
+                {
+                    dispatch(buffer, index);
+                }
+                index = 0;
             }
-            index = 0;
         }
     }
 }
@@ -10,33 +10,114 @@
 #include <BTextNotifiers.h>
 #include <BtSdp.h>
 
+#include "GameBTCommsProfile.h"
+#include "MessageReader.h"
+
 class CMessageServiceSearcher;
 
+/*!
+  @class MMessageClientObserver
+
+  @discussion Receives notifications from CMessageClient
+  */
+class MMessageClientObserver
+    {
+public:
+/*!
+  @function WriteComplete
+
+  @discussion Called when data passed to CMessageClient::WriteL has been
+  written or dropped.  The data may be released from here on.
+  @param aData the data passed to WriteL
+  @param aError KErrNone if the data was written
+  */
+    virtual void WriteComplete(const TDesC8& aData, TInt aError) = 0;
+
+/*!
+  @function ReadComplete
+
+  @discussion Called from the reader's RunL with the data just read.  The
+  data is only valid for the duration of the call.  Whatever is not
+  consumed is stored and can be fetched with CMessageClient::PollMessagesL.
+  @param aData the bytes read from the socket
+  @result the number of bytes consumed from the start of aData
+  */
+    virtual TInt ReadComplete(const TDesC8& aData) = 0;
+    };
+
+/*!
+  @struct TMessageIoStats
+
+  @discussion Counters describing the traffic on the link
+  */
+struct TMessageIoStats
+    {
+    TUint32 iReads;         ///< Completed reads
+    TUint32 iBytesRead;     ///< Bytes received
+    TUint32 iBytesDropped;  ///< Bytes received but not polled in time
+    TUint32 iLastReadTime;  ///< Time in us the last read was posted before data arrived
+    TUint32 iWrites;        ///< Completed writes
+    TUint32 iBytesWritten;  ///< Bytes sent
+    TUint32 iLastWriteTime; ///< Time in us between issuing and completing the last write
+    TUint32 iMaxWriteTime;  ///< Longest write round trip in us
+    TUint32 iCorruptBatches; ///< Batches dropped by the CRC check, see CGameBTComms::GetIoStats
+    TUint32 iBadFragments;   ///< Fragments longer than the message they announce, see CGameBTComms::GetIoStats
+    };
+
+/*!
+  @class MMessageLink
+
+  @discussion The operations a game link offers, implemented by
+  CMessageClient and by proxies forwarding to a CMessageClient running in
+  another thread.
+  */
+class MMessageLink
+    {
+public:
+    virtual TBool IsConnected() = 0;
+    virtual TBool IsReadyToSendMessage() = 0;
+    virtual void ConnectL() = 0;
+    virtual void DisconnectL() = 0;
+    virtual void SendMessageL(const TDesC8& aMessage) = 0;
+    virtual void WriteL(const TDesC8& aData) = 0;
+    virtual TBool PollMessagesL(TDes8& aBuffer) = 0;
+    virtual TInt BufferedLength() const = 0;
+    virtual const TMessageIoStats& IoStats() const = 0;
+    };
+
 /*! 
   @class CMessageClient
   
-  @discussion Connects and sends messages to a remote machine using bluetooth
+  @discussion Connects and sends messages to a remote machine using bluetooth.
+  Writes are driven by this object while a CMessageReader keeps a read
+  posted, so the link is used in both directions at the same time.
   */
-class CMessageClient : public CActive
+class CMessageClient : public CActive, public MMessageReaderObserver, public MMessageLink
     {
 public:
-    enum { KMaximumMessageLength = 512 };
+    enum { KMaximumMessageLength = GAMECOMMS_TX_BUFFER_SIZE };
+    enum { KReceiveBufferLength = GAMECOMMS_RECV_BUFFER_SIZE };
+    enum { KTransmitSlots = 2 };
+
+    typedef TMessageIoStats TIoStats;
 
  /*!
   @function NewL
   
   @discussion Construct a CMessageClient
+  @param aObserver receives write completions, may be NULL
   @result a pointer to the created instance of CMessageClient
   */
-    static CMessageClient* NewL();
+    static CMessageClient* NewL(MMessageClientObserver* aObserver = NULL);
 
 /*!
   @function NewLC
   
   @discussion Construct a CMessageClient
+  @param aObserver receives write completions, may be NULL
   @result a pointer to the created instance of CMessageClient
   */
-    static CMessageClient* NewLC();
+    static CMessageClient* NewLC(MMessageClientObserver* aObserver = NULL);
 
 /*!
   @function ~CMessageClient
@@ -69,7 +150,7 @@ public:
 /*!
   @function IsReadyToSendMessage
   
-  @result ETrue if the client can send a message.
+  @result ETrue if the client is connected and a transmit slot is free.
   */
     TBool IsReadyToSendMessage();
 
@@ -90,11 +171,46 @@ public:
 /*!
   @function SendMessageL
 
-  @discussion Sends a message to a service on a remote machine.
+  @discussion Sends a message to a service on a remote machine.  The
+  message is copied into a preallocated transmit buffer.
   */    
     void SendMessageL(const TDesC8& aMessage);
+
+/*!
+  @function WriteL
+
+  @discussion Writes data to the remote machine without taking a copy.
+  The caller must keep the data unchanged until
+  MMessageClientObserver::WriteComplete is called for it.  If a write is
+  already in flight the data is queued and written as soon as the
+  previous write completes.
+  @param aData the data to be sent
+  */
+    void WriteL(const TDesC8& aData);
     
-    void PollMessagesL(char aBuffer[KMaximumMessageLength], TUint16& Length);
+/*!
+  @function PollMessagesL
+
+  @discussion Moves received data into the caller's buffer.  Only as
+  much as fits is moved, the rest is kept for the next call.
+  @param aBuffer the data is appended to this buffer
+  @result ETrue if received data is left over
+  */
+    TBool PollMessagesL(TDes8& aBuffer);
+
+/*!
+  @function BufferedLength
+
+  @result the number of received bytes waiting to be polled
+  */
+    TInt BufferedLength() const;
+
+/*!
+  @function IoStats
+
+  @result the read and write counters
+  */
+    const TIoStats& IoStats() const;
 
     protected:    // from CActive
 /*!
@@ -126,22 +242,62 @@ private:
   */    
     void DisconnectFromServerL();
 
-    void RequestData();
+/*!
+  @function HasReadSpace
+
+  @discussion Checks whether a complete read fits into the receive buffer
+  @result ETrue if the next read can be posted
+  */
+    TBool HasReadSpace() const;
+
+/*!
+  @function UpdateWriteTime
+
+  @discussion Records the round trip time of the write that just completed
+  */
+    void UpdateWriteTime();
+
+private:    // from MMessageReaderObserver
+    TBool DataReceived(const TDesC8& aData);
+    void ReadError(TInt aError);
+
+private:
+
+/*!
+  @function QueueWriteL
+
+  @discussion Places data in the next free transmit slot and starts
+  writing if the socket is idle.
+  */
+    void QueueWriteL(const TDesC8& aData, TBool aBorrowed);
+
+/*!
+  @function StartWrite
+
+  @discussion Writes the oldest transmit slot.
+  */
+    void StartWrite();
+
+/*!
+  @function AbortWrites
+
+  @discussion Drops all queued transmit slots.
+  */
+    void AbortWrites(TInt aError);
 
 /*!
   @function CMessageClient
 
   @discussion Constructs this object
   */
-    CMessageClient();
+    CMessageClient(MMessageClientObserver* aObserver);
 
 /*!
   @function ConstructL
 
   @discussion Performs second phase construction of this object
-  @param aMessage the message to be sent to the remote machine
   */
-    void ConstructL(const TDesC8& aMessage);
+    void ConstructL();
 
 private:
 
@@ -175,8 +331,23 @@ private:
     /*! @var iServiceSearcher searches for service this client can connect to */
     CMessageServiceSearcher* iServiceSearcher;
 
-    /*! @var iMessage a copy of the message to send */
-    HBufC8* iMessage;
+    /*! @var iObserver receives write completions */
+    MMessageClientObserver* iObserver;
+
+    /*! @var iTxBuffer preallocated copies of messages passed to SendMessageL */
+    TBuf8<KMaximumMessageLength> iTxBuffer[KTransmitSlots];
+
+    /*! @var iTxData the data each transmit slot writes */
+    TPtrC8 iTxData[KTransmitSlots];
+
+    /*! @var iTxBorrowed ETrue if the slot refers to memory passed to WriteL */
+    TBool iTxBorrowed[KTransmitSlots];
+
+    /*! @var iTxHead the slot that is written next or in flight */
+    TInt iTxHead;
+
+    /*! @var iTxCount the number of occupied transmit slots */
+    TInt iTxCount;
 
     /*! @var iSocketServer a connection to the socket server */
     RSocketServ iSocketServer;
@@ -187,11 +358,17 @@ private:
     /*! @var iServiceClass the service class UUID to search for */
     TUUID iServiceClass;
 
-	/*! @var iBuffer buffer needed for read on connection to server */
-	TBuf8 <KMaximumMessageLength> iBuffer;
+    /*! @var iReader keeps a read posted on iSendingSocket */
+    CMessageReader* iReader;
+
+	/*! @var iBuffer data received but not yet polled */
+	TBuf8 <KReceiveBufferLength> iBuffer;
+
+    /*! @var iWriteStarted time the write in flight was issued */
+    TTime iWriteStarted;
 
-    /*! @var iLen length of data read */
-    TSockXfrLength iLen;
+    /*! @var iIoStats read and write counters */
+    TIoStats iIoStats;
 
     };
 
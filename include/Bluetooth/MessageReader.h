@@ -0,0 +1,134 @@
+/* Copyright (c) 2002, Nokia. All rights reserved */
+
+#ifndef __MESSAGEREADER_H__
+#define __MESSAGEREADER_H__
+
+#include <e32base.h>
+#include <es_sock.h>
+
+#include "GameBTCommsProfile.h"
+
+/*!
+  @class MMessageReaderObserver
+
+  @discussion Receives the data read by a CMessageReader
+  */
+class MMessageReaderObserver
+    {
+public:
+/*!
+  @function DataReceived
+
+  @discussion Called for every completed read.  The data is only valid
+  for the duration of the call.
+  @param aData the bytes read from the socket
+  @result ETrue to post the next read, EFalse to pause reading until
+  CMessageReader::Start is called again
+  */
+    virtual TBool DataReceived(const TDesC8& aData) = 0;
+
+/*!
+  @function ReadError
+
+  @discussion Called when a read fails, e.g. because the connection was lost
+  @param aError the error code of the read
+  */
+    virtual void ReadError(TInt aError) = 0;
+    };
+
+/*!
+  @class CMessageReader
+
+  @discussion Keeps a read posted on a connected socket so that incoming
+  data is received independently of any write in progress.
+  */
+class CMessageReader : public CActive
+    {
+public:
+    enum { KReadBufferLength = GAMECOMMS_READ_BUFFER_SIZE };
+
+/*!
+  @function NewL
+
+  @discussion Construct a CMessageReader
+  @param aSocket the connected socket to read from
+  @param aObserver receives the data read
+  @result a pointer to the created instance of CMessageReader
+  */
+    static CMessageReader* NewL(RSocket& aSocket, MMessageReaderObserver& aObserver);
+
+/*!
+  @function ~CMessageReader
+
+  @discussion Cancel any outstanding read
+  */
+    ~CMessageReader();
+
+/*!
+  @function Start
+
+  @discussion Post the first read, further reads are posted automatically
+  while the observer accepts data.  Also resumes a paused reader, does
+  nothing if a read is outstanding.
+  */
+    void Start();
+
+/*!
+  @function LastReadTime
+
+  @result time in microseconds the last read was posted before data arrived
+  */
+    TUint32 LastReadTime() const;
+
+protected:    // from CActive
+/*!
+  @function DoCancel
+
+  @discussion Cancel the outstanding read
+  */
+    void DoCancel();
+
+/*!
+  @function RunL
+
+  @discussion Deliver the data read and post the next read unless the
+  observer paused reading
+  */
+    void RunL();
+
+private:
+/*!
+  @function CMessageReader
+
+  @discussion Constructs this object
+  */
+    CMessageReader(RSocket& aSocket, MMessageReaderObserver& aObserver);
+
+/*!
+  @function RequestData
+
+  @discussion Post a read on the socket
+  */
+    void RequestData();
+
+private:
+    /*! @var iSocket the socket to read from, owned by the client */
+    RSocket& iSocket;
+
+    /*! @var iObserver receives the data read */
+    MMessageReaderObserver& iObserver;
+
+    /*! @var iBuffer buffer needed for read on connection to server */
+    TBuf8<KReadBufferLength> iBuffer;
+
+    /*! @var iLen length of data read */
+    TSockXfrLength iLen;
+
+    /*! @var iPosted time the outstanding read was posted */
+    TTime iPosted;
+
+    /*! @var iLastReadTime time in microseconds the last read was outstanding */
+    TUint32 iLastReadTime;
+    };
+
+#endif // __MESSAGEREADER_H__
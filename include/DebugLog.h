@@ -10,6 +10,9 @@
 #ifndef DEBUG_LOG_H
 #define DEBUG_LOG_H
 
+#include <stdarg.h>
+
 void DebugLog(const char* filename, const char* format, ...);
+void DebugLogV(const char* filename, const char* format, va_list varg);
 
 #endif /* DEBUG_LOG_H */
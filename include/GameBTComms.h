@@ -15,20 +15,52 @@
 
  /**
   * @def VERSION
-  *      Version of GameComms implementation.
+  *      Version of GameComms implementation, set by the build (see
+  *      GAMECOMMS_VERSION in CMakeLists.txt).
   */
+#ifndef VERSION
 #define VERSION 1
+#endif
+
+ /**
+  * @def GAMECOMMS_EXTENDED_API
+  *      1 exports the functions added to the original API, such as the
+  *      send lanes, the flush and pump control and the statistics, set
+  *      by the build (see GAMECOMMS_EXTENDED_API in CMakeLists.txt).
+  *      With 0 they are only used internally and the DLL exports the
+  *      same functions at the same ordinals as the original one.
+  */
+#ifndef GAMECOMMS_EXTENDED_API
+#define GAMECOMMS_EXTENDED_API 0
+#endif
+
+#if GAMECOMMS_EXTENDED_API
+#define GAMECOMMS_IMPORT_C IMPORT_C
+#define GAMECOMMS_EXPORT_C EXPORT_C
+#else
+#define GAMECOMMS_IMPORT_C
+#define GAMECOMMS_EXPORT_C
+#endif
 
 #include <btsdp.h>
 #include <e32base.h>
 #include <e32std.h>
 #include <es_sock.h>
 #include "GameBTCommsConsts.h"
+#include "GameBTCommsNotify.h"
+#include "GameBTCommsProfile.h"
 #include "MessageClient.h"
 
 class MGameBTCommsNotify;
 class RSGEDebugLog;
 class CGameBTBase;
+class CGameBTCommsRing;
+class CGameBTCommsDelta;
+class CGameBTCommsLz;
+
+#if VERSION >= 10
+class TDeviceDetails; /* Only passed by reference, layout unknown */
+#endif
 
 struct TBTCommsMsgBase;
 
@@ -44,7 +76,7 @@ struct TBTCommsMsgBase;
  *        transfer data between devices.  It also provides functionality
  *        for common scenarios (e.g. Pause / Continue).
  */
-class CGameBTComms : public CBase
+class CGameBTComms : public CBase, public MMessageClientObserver
 {
 public:
     /**
@@ -92,7 +124,7 @@ public:
     };
     enum TGameCommsState
     {
-        EInit, ERegisterUID, ERegisterDeviceName, ERegisterNetConfig, ERegisterRole, EHandleMessages
+        EInit, ERegisterAck, ERegisterUID, ERegisterDeviceName, ERegisterNetConfig, ERegisterProtocol, ERegisterRole, EHandleMessages
     };
     enum TRecipientId
     {
@@ -100,16 +132,127 @@ public:
     };
     enum
     {
-        KMaxQueueSize   = 32,
-        KMaxMessageSize = 64
+        KSendArenaSize    = GAMECOMMS_SEND_ARENA_SIZE, ///< Budget shared by all outgoing frames
+        KFrameHeaderSize  = 2,      ///< Recipient and length byte of a frame
+        KFrameOverhead    = 3,      ///< Header plus the trailing new line
+        KMaxPayloadLength = 255,    ///< Limited by the 1 byte length field on the wire
+        KMaxMessageLength = 0xffff, ///< Largest message, sent in fragments once the hub speaks protocol 2
+        KRecvBufferSize   = GAMECOMMS_RECV_BUFFER_SIZE, ///< Holds at least one complete frame
+        KThreadRingSize   = GAMECOMMS_THREAD_RING_SIZE, ///< Size of each ring between game and comms thread
+        KThreadInterval   = 20000,  ///< Time in us between two status updates of the comms thread
+        KMaxLineLength    = 80,     ///< Longest registration line or frame
+        KReassemblySize   = GAMECOMMS_REASSEMBLY_SIZE, ///< Default largest fragmented message in static memory mode
+        KMaxBatchFrames   = 32,     ///< Messages per MGameBTCommsBatchNotify::ReceiveBatch call
+        KBatchBufferSize  = GAMECOMMS_BATCH_BUFFER_SIZE ///< Bytes per MGameBTCommsBatchNotify::ReceiveBatch call
+    };
+    enum
+    {
+        KFragmentMore       = 0x80, ///< Recipient flag: another fragment follows
+        KFragmentNext       = 0x40, ///< Recipient flag: continues the previous fragment
+        KRecipientMask      = 0x27, ///< Recipient or sender without the other flags
+        KRecipientMulticast = 0x20, ///< Recipient flag: bits 0 to 2 select clients 1 to 3
+        KChannelPresent     = 0x10, ///< Protocol 2 header flag: a channel byte follows the length
+        KDeltaCoded         = 0x08  ///< Header flag: the payload is coded by CGameBTCommsDelta
+    };
+    enum
+    {
+        KProtocolVersion = 2,       ///< Highest protocol version offered during registration
+        KUpgradeMarker   = 'V',     ///< First payload byte of the version switch frame
+        KUpgradeSize     = 5,       ///< Size of the version switch frame on the wire
+        KMaxHeaderSize   = 6,       ///< Header, 2 byte length, channel and timestamp of a protocol 2 frame
+        KCompressedBlock = 0x06,    ///< Protocol 2 header of a compressed block of frames
+        KCompressBlock   = 512,     ///< Largest block before compression, see CGameBTCommsLz
+        KCapCompress     = 0x01,    ///< Capability: the hub accepts compressed blocks
+        KCapCrc          = 0x02,    ///< Capability: protocol 2 batches end with a CRC trailer
+        KCapClock        = 0x04,    ///< Capability: data frames carry a timestamp, the hub answers clock requests
+        KCrcTrailer      = 0x07,    ///< Protocol 2 header of a CRC trailer
+        KCrcTrailerSize  = 4,       ///< Header, length and CRC-16 of a trailer
+        KCrcSpan         = 256,     ///< Batch size after which a trailer is written
+        KRegisterMarker  = 'R',     ///< First payload byte of the registration frame and its answer
+        KRegisterFormat  = 1,       ///< Layout of the registration frame
+        KRegisterTimeout = 2000000, ///< Time in us to wait for the answer before falling back to text
+        KClockMarker     = 'T',     ///< First payload byte of a clock request and its answer
+        KVoidMarker      = 0x00,    ///< First payload byte of a voided frame, never a control marker
+        KClockSamples    = 8,       ///< Clock exchanges the estimate is picked from
+        KStampSize       = 2,       ///< Size of the timestamp of a protocol 2 data frame
+        KStampShift      = 10,      ///< Timestamps count units of 1024 us of the hub's clock
+        KUnsyncedStamp   = 0xffff,  ///< Timestamp sent before the first clock exchange, means no timestamp
+        KWireBufferSize  = KUpgradeSize + KSendArenaSize + KSendArenaSize / 2 + KSendArenaSize / 16 + KCrcTrailerSize ///< Largest protocol 2 transcoding of the arena
+    };
+    enum TSendLane
+    {
+        EReliableOrdered, ///< Every payload is delivered in order
+        ELatestWins       ///< An unsent payload is replaced by a newer one on the same channel
+    };
+    enum TReceiveMode
+    {
+        EReceivePolled, ///< Data is delivered by the pump timer or Pump(), see SetPumpInterval()
+        EReceiveEvent   ///< Data is delivered as soon as it has been read
+    };
+    enum
+    {
+        KMaxLatestChannels = 8 ///< Channel ids available to ELatestWins
+    };
+    enum
+    {
+        KDefaultKeyInterval   = 30,     ///< Delta coded messages per channel between two keyframes
+        KDefaultClockInterval = 1000000 ///< Time in us between two clock requests
     };
+    enum
+    {
+        KDefaultFlushThreshold = 128,   ///< Queued bytes that trigger a flush
+        KDefaultFlushDelay     = 20000, ///< Maximum time in us a frame waits for a flush
+        KMinFlushDelay         = 1000   ///< Shortest flush timer period in us
+    };
+    enum
+    {
+        KDefaultPumpInterval = 10000, ///< Time in us between two scheduled pumps
+        KMinPumpInterval     = 1000,  ///< Shortest scheduled pump period in us
+        KFrameCost           = 250    ///< Estimated time in us to handle one frame, see Pump(TInt)
+    };
+
+    /**
+     * @brief Determines when queued frames are written to the link.
+     *
+     *        A flush happens as soon as the first of the following is
+     *        true: iByteThreshold bytes are queued, the oldest queued
+     *        frame has waited iMaxDelay microseconds, or Flush() was
+     *        called.
+     */
     typedef struct
     {
-        TUint8 Pos;
-        TUint8 Length[KMaxQueueSize];
-        TUint8 Queue[KMaxQueueSize][KMaxMessageSize];
+        TInt iByteThreshold; ///< Queued bytes that trigger a flush
+        TInt iMaxDelay;      ///< Maximum time in us a frame waits for a flush
+
+    } TFlushPolicy;
 
-    } TMessageQueue;
+    /**
+     * @brief Counters describing the flushes performed so far.
+     */
+    typedef struct
+    {
+        TUint32 iFlushes;       ///< Number of writes issued
+        TUint32 iFrames;        ///< Total number of frames written
+        TUint32 iMaxFrames;     ///< Most frames coalesced into a single write
+        TUint32 iLastLatency;   ///< Time in us the oldest frame of the last flush waited
+        TUint32 iMaxLatency;    ///< Longest time in us a frame waited for a flush
+        TUint32 iTotalLatency;  ///< Sum of all flush latencies in us
+        TUint32 iBlockBytes;    ///< Protocol 2 bytes offered to the compressor
+        TUint32 iPackedBytes;   ///< Bytes written for them, compressed or not
+
+    } TFlushStats;
+
+    /**
+     * @brief Occupancy of the send queue for one recipient.
+     */
+    typedef struct
+    {
+        TInt iQueuedBytes;   ///< Bytes waiting for or in transmission, including framing
+        TInt iQueuedFrames;  ///< Frames waiting for or in transmission
+        TInt iHighWaterMark; ///< Largest value iQueuedBytes has reached
+        TInt iFreeBytes;     ///< Space left in the send queue shared by all recipients
+
+    } TQueueStatus;
 
 #if VERSION >= 10
 
@@ -292,7 +435,7 @@ public:
      */
     IMPORT_C void Disconnect();
 
-#endif /* VERSION > 10 */
+#endif /* VERSION < 10 */
 
     /**
      * @name  DisconnectClient
@@ -352,6 +495,9 @@ public:
      * @retval KErrPaused   If the game is in a paused state
      * @retval KErrGameOver If in a game over state
      *
+     * @retval KErrOverflow If the send queue is full; the data was
+     *                      not sent
+     *
      */
     IMPORT_C TInt SendDataToClient(TUint16 aClientId, TDesC8 &aData);
 
@@ -378,6 +524,9 @@ public:
      *
      * @retval KErrGameOver If in a game over state
      *
+     * @retval KErrOverflow If the send queue is full; the data was
+     *                      not sent
+     *
      */
     IMPORT_C TInt SendDataToAllClients(TDesC8 &aData);
 
@@ -403,6 +552,9 @@ public:
      *
      * @retval KErrGameOver If in a game over state
      *
+     * @retval KErrOverflow If the send queue is full; the data was
+     *                      not sent
+     *
      */
     IMPORT_C TInt SendDataToHost(TDesC8 &aData);
 
@@ -582,9 +734,344 @@ public:
 
 #endif /* VERSION >= 10 */
 
-    void Update(TUint16 aClientId = EInvalid, const char *aData = NULL, TUint16 aLength = 0, const char *sDebug = NULL);
+    /**
+     * @name  SendDataToClient
+     *
+     * @fn    TInt SendDataToClient(TUint16 aClientId, TDesC8& aData, TSendLane aLane, TUint8 aChannel)
+     *
+     * @brief Same as SendDataToClient(TUint16, TDesC8&) but lets the
+     *        caller select the send lane.
+     *
+     *        With ELatestWins a payload that is still waiting in the
+     *        queue for the same client and channel is replaced, so only
+     *        the newest snapshot goes over the link.
+     *
+     * @param aClientId Id of the client (from 1 to
+     *                  CGameBTComms::KMaxPlayers - 1)
+     *
+     * @param aData     Descriptor containing the data
+     *
+     * @param aLane     EReliableOrdered or ELatestWins
+     *
+     * @param aChannel  Channel id used by ELatestWins (from 0 to
+     *                  CGameBTComms::KMaxLatestChannels - 1)
+     *
+     * @return Any EPOC error code
+     *
+     * @retval KErrNone     If successful
+     *
+     * @retval KErrArgument If the channel id is out of range
+     *
+     * @retval KErrTooBig   If the data is longer than KMaxPayloadLength
+     *                      and the hub has not accepted protocol 2,
+     *                      or longer than KMaxMessageLength
+     *
+     * @retval KErrOverflow If the send queue is full; the data was
+     *                      not sent
+     */
+    GAMECOMMS_IMPORT_C TInt SendDataToClient(TUint16 aClientId, TDesC8 &aData, TSendLane aLane, TUint8 aChannel);
+
+    /**
+     * @name  SendDataToAllClients
+     *
+     * @fn    TInt SendDataToAllClients(TDesC8& aData, TSendLane aLane, TUint8 aChannel)
+     *
+     * @brief Same as SendDataToAllClients(TDesC8&) but lets the caller
+     *        select the send lane.
+     *
+     * @see   SendDataToClient(TUint16, TDesC8&, TSendLane, TUint8)
+     */
+    GAMECOMMS_IMPORT_C TInt SendDataToAllClients(TDesC8 &aData, TSendLane aLane, TUint8 aChannel);
+
+    /**
+     * @name  SendDataToHost
+     *
+     * @fn    TInt SendDataToHost(TDesC8& aData, TSendLane aLane, TUint8 aChannel)
+     *
+     * @brief Same as SendDataToHost(TDesC8&) but lets the caller select
+     *        the send lane.
+     *
+     * @see   SendDataToClient(TUint16, TDesC8&, TSendLane, TUint8)
+     */
+    GAMECOMMS_IMPORT_C TInt SendDataToHost(TDesC8 &aData, TSendLane aLane, TUint8 aChannel);
+
+    /**
+     * @name  GetQueueStatus
+     *
+     * @fn    TInt GetQueueStatus(TUint16 aRecipient, TQueueStatus& aStatus)
+     *
+     * @brief Retrieves how much data is queued for a recipient.
+     *
+     *        Games can use this to reduce their send rate before the
+     *        queue overflows.
+     *
+     * @param aRecipient One of TRecipientId (EToHost to EToAll)
+     *
+     * @param aStatus    Receives the queue occupancy
+     *
+     * @return Any EPOC error code
+     *
+     * @retval KErrNone     If successful
+     *
+     * @retval KErrArgument If aRecipient is out of range
+     */
+    GAMECOMMS_IMPORT_C TInt GetQueueStatus(TUint16 aRecipient, TQueueStatus &aStatus);
+
+    /**
+     * @name  SetFlushPolicy
+     *
+     * @fn    void SetFlushPolicy(const TFlushPolicy& aPolicy)
+     *
+     * @brief Changes when queued frames are written to the link.
+     *
+     *        The defaults can also be set in `E:\GameComms.ini` using
+     *        the keys `Threshold` (bytes) and `MaxDelay` (ms) of the
+     *        section `[Flush]`.
+     *
+     * @param aPolicy New flush policy
+     */
+    GAMECOMMS_IMPORT_C void SetFlushPolicy(const TFlushPolicy &aPolicy);
+
+    /**
+     * @name  Flush
+     *
+     * @fn    TInt Flush()
+     *
+     * @brief Writes all queued frames as soon as the link allows it,
+     *        regardless of the flush policy.
+     *
+     * @return KErrNone, or the error that stopped the write; the
+     *         frames stay queued and are written by the next pump
+     */
+    GAMECOMMS_IMPORT_C TInt Flush();
+
+    /**
+     * @name  GetFlushStats
+     *
+     * @fn    void GetFlushStats(TFlushStats& aStats)
+     *
+     * @brief Retrieves the flush counters.
+     *
+     * @param aStats Receives the counters
+     */
+    GAMECOMMS_IMPORT_C void GetFlushStats(TFlushStats &aStats);
+
+    /**
+     * @name  SetBatchNotify
+     *
+     * @fn    void SetBatchNotify(MGameBTCommsBatchNotify* aBatchNotify)
+     *
+     * @brief Registers an optional receiver for batched messages.
+     *
+     *        While set, all messages decoded in one pump (one Update()
+     *        in EReceivePolled mode, one completed read in
+     *        EReceiveEvent mode) are collected in one buffer and
+     *        passed to MGameBTCommsBatchNotify::ReceiveBatch with a
+     *        single call instead of one ReceiveDataFrom* call each.
+     *        A pump yielding more than KMaxBatchFrames messages or
+     *        KBatchBufferSize bytes is split into several calls.
+     *
+     * @param aBatchNotify Receiver, or NULL to use the per message
+     *                     callbacks only
+     */
+    GAMECOMMS_IMPORT_C void SetBatchNotify(MGameBTCommsBatchNotify *aBatchNotify);
+
+    /**
+     * @name  SetReceiveMode
+     *
+     * @fn    TInt SetReceiveMode(TReceiveMode aMode)
+     *
+     * @brief Selects when ReceiveDataFromClient and ReceiveDataFromHost
+     *        are called.
+     *
+     *        With EReceiveEvent the callbacks are made from the active
+     *        scheduler as soon as a read completes, regardless of
+     *        whether the game calls into the library.  The game must
+     *        then be prepared to receive data at any point where its
+     *        active scheduler runs.  The default is EReceivePolled
+     *        unless `EventDriven=1` is set in the section `[Receive]`
+     *        of `E:\GameComms.ini`.  With `Enabled=1` in the section
+     *        `[Thread]` reads complete in the comms thread, and data
+     *        is always delivered by the pump.
+     *
+     * @param aMode EReceivePolled or EReceiveEvent
+     *
+     * @return KErrNone, or the error that stopped delivering the data
+     *         received before switching to EReceiveEvent; the mode is
+     *         changed nevertheless
+     */
+    GAMECOMMS_IMPORT_C TInt SetReceiveMode(TReceiveMode aMode);
+
+    /**
+     * @name  GetIoStats
+     *
+     * @fn    void GetIoStats(CMessageClient::TIoStats& aStats)
+     *
+     * @brief Retrieves the read and write counters of the Bluetooth
+     *        link, including the round trip time of the last read and
+     *        write.
+     *
+     * @param aStats Receives the counters
+     */
+    GAMECOMMS_IMPORT_C void GetIoStats(CMessageClient::TIoStats &aStats);
+
+    /**
+     * @name  GetLatency
+     *
+     * @fn    TInt GetLatency(TInt& aOneWay)
+     *
+     * @brief Retrieves the estimated time a frame takes from this
+     *        device to the hub.
+     *
+     *        The estimate is half the round trip time of the fastest
+     *        of the last KClockSamples clock exchanges with the hub.
+     *        Exchanges are made with `Enabled=1` in the section
+     *        `[Clock]` of `E:\GameComms.ini`, every `Interval` ms
+     *        (default 1000), if the hub accepts them.
+     *
+     * @param aOneWay Receives the latency in us
+     *
+     * @return KErrNone, or KErrNotReady before the first exchange
+     */
+    GAMECOMMS_IMPORT_C TInt GetLatency(TInt &aOneWay);
+
+    /**
+     * @name  GetFrameAge
+     *
+     * @fn    TInt GetFrameAge(TInt& aAge)
+     *
+     * @brief Retrieves how long ago the message being delivered was
+     *        sent.
+     *
+     *        Only valid from within ReceiveDataFromClient or
+     *        ReceiveDataFromHost.  Messages delivered through
+     *        MGameBTCommsBatchNotify carry no age.  The sender stamps
+     *        a message with the hub's clock, as it estimates it, when
+     *        writing it to the link, so the age covers both links and
+     *        this device's receive buffer but not the time the message
+     *        waited in the sender's queue.  Timestamps count 1024 us,
+     *        but both clocks only advance in ticks of 15.625 ms, so
+     *        the age is accurate to about two ticks.
+     *
+     * @param aAge Receives the age in us
+     *
+     * @return KErrNone, KErrNotReady before this device's first clock
+     *         exchange, or KErrNotFound if the message carries no
+     *         timestamp, its sender had not synchronised yet, no
+     *         message is being delivered or messages are delivered
+     *         in batches
+     */
+    GAMECOMMS_IMPORT_C TInt GetFrameAge(TInt &aAge);
+
+    /**
+     * @name  SetPumpInterval
+     *
+     * @fn    void SetPumpInterval(TInt aInterval)
+     *
+     * @brief Changes how often the library makes progress on its own.
+     *
+     *        Registration, sending and receiving are driven by a timer
+     *        running from the game's active scheduler.  The default
+     *        can also be set in `E:\GameComms.ini` using the key
+     *        `Interval` (ms) of the section `[Pump]`.
+     *
+     * @param aInterval Time in us between two pumps, or 0 to stop the
+     *                  timer and call Pump() from the game instead
+     */
+    GAMECOMMS_IMPORT_C void SetPumpInterval(TInt aInterval);
+
+    /**
+     * @name  Pump
+     *
+     * @fn    TInt Pump()
+     *
+     * @brief Makes progress on registration, sending and receiving.
+     *
+     *        Called by the library's own timer unless the pump interval
+     *        is 0.  The state getters never do so.
+     *
+     * @return KErrNone, or the error that stopped the pump; the next
+     *         call continues where it stopped
+     */
+    GAMECOMMS_IMPORT_C TInt Pump();
+
+    /**
+     * @name  Pump
+     *
+     * @fn    TInt Pump(TInt aBudget)
+     *
+     * @brief Makes progress within a time budget.
+     *
+     *        Queued frames are written and received frames are decoded
+     *        and delivered until the budget is spent; the pump then
+     *        stops at the next frame boundary and continues where it
+     *        left off on the next call.  At least one frame is handled
+     *        per call.
+     *
+     *        The system clock only ticks every 15.625 ms, so the budget
+     *        also limits the number of frames handled to one per
+     *        KFrameCost us.
+     *
+     * @param aBudget Time in us the call may take
+     *
+     * @return Number of received bytes still waiting to be delivered
+     *         plus queued bytes that are due but not yet written to
+     *         the link, 0 if the pump finished within the budget, or
+     *         a negative error code if the pump stopped because of an
+     *         error
+     */
+    GAMECOMMS_IMPORT_C TInt Pump(TInt aBudget);
+
+    void Update();
 
 private:
+    TInt Enqueue(TUint16 aRecipient, const TDesC8 &aData, TSendLane aLane = EReliableOrdered, TUint8 aChannel = 0);
+    void SendRegistrationL();
+    void RegistrationComplete();
+    TInt OfferedCapabilities() const;
+    void SyncClockL();
+    void ClockAnswer(const TUint8 *aData);
+    TUint16 Stamp() const;
+    TBool Stamped(TUint8 aHeader) const;
+    void SendQueued();
+    void SendPendingL();
+    static TUint16 ClientRecipient(TUint16 aClientId);
+    static TBool Reaches(TUint8 aTarget, TUint8 aRecipient);
+    TBool Coalesce(TUint8 aRecipient, const TDesC8 &aData);
+    void AddQueued(TUint8 aRecipient, TInt aBytes);
+    TUint8 *AppendFrame(TUint8 aHeader, const TUint8 *aPrefix, TInt aPrefixLength, const TUint8 *aData, TInt aLength);
+    void ReceiveFrame(TUint8 aHeader, const TDesC8 &aPayload);
+    void ReceiveDelta(TUint8 aSender, const TDesC8 &aPayload);
+    HBufC8 *StartReassembly(TUint8 aSender, TInt aLength);
+    void EndReassembly(TUint8 aSender);
+    TBool GameSenderId(TUint8 aSender, TUint16 &aId) const;
+    void Deliver(TUint8 aSender, const TDesC8 &aData);
+    void FlushBatch();
+    void Dispatch(TUint16 aId, const TDesC8 &aData);
+    void ReceivePendingL();
+    void DrainClientL();
+    TInt DecodeFrames(const TDesC8 &aData);
+    TInt DecodeRun(const TDesC8 &aData, TBool aInterruptible);
+    TInt DecodeBatch(const TDesC8 &aData);
+    TBool ParseHeader(const TUint8 *aData, TInt aLength, TInt &aHeaderSize, TInt &aPayload) const;
+    TInt LatestChannel(const TUint8 *aFrame) const;
+    TInt EncodeFrames(const TDesC8 &aFrames, TUint8 *aWire);
+    TInt TranscodeFrame(const TUint8 *aFrame, TUint8 *aWire);
+    TInt PackBlock(TInt aLength, TUint8 *aWire);
+    void Log(const char *aFormat, ...);
+    TInt SwitchVersion(TUint8 *aWire);
+    TInt AppendTrailer(TUint8 *aBatch, TInt aLength);
+    TInt MissingBytes() const;
+    TBool BudgetSpent() const;
+    TInt ReceiveBacklog() const;
+    TInt SendBacklog() const;
+    void WriteComplete(const TDesC8 &aData, TInt aError);
+    TInt ReadComplete(const TDesC8 &aData);
+    void ReleaseFrames(const TDesC8 &aFrames);
+    void StartFlushTimer();
+    static TInt FlushTimerCallBack(TAny *aSelf);
+    void StartPumpTimer();
+    static TInt PumpTimerCallBack(TAny *aSelf);
 
 protected:
 
@@ -619,12 +1106,69 @@ private:
     TGameCommsState iGameCommsState;     ///< Current main state
     TUint16         iStartPlayers;       ///< Number of players required before the game can start
     TUint16         iMinPlayers;         ///< Minimum number of players needed in game after starting to continue playing
-    CMessageClient *iClient;             ///< iClient the message sending engine
+    char            iDeviceName[32];     ///< Device name, read once from the ini file
+    char            iHost[32];           ///< Relay host, read once from the ini file
+    TInt            iPort;               ///< Relay port, read once from the ini file
+    TTime           iRegisterSent;       ///< Time the registration frame was sent
+    MMessageLink   *iClient;             ///< iClient the message sending engine
+    CBase          *iClientObject;       ///< Owns iClient, a CMessageClient or a CGameBTCommsThread
+
+    TBuf8<KRecvBufferSize> iRecvBuffer; ///< Received bytes, starts at a frame boundary
+    TBool           iDecoding;           ///< Guards against re-entry from receive callbacks
+    TReceiveMode    iReceiveMode;        ///< When received data is delivered
+    MGameBTCommsBatchNotify *iBatchNotify;        ///< Optional receiver of batched messages
+    TGameBTCommsFrame iBatch[KMaxBatchFrames];   ///< Messages not yet passed to iBatchNotify
+    TInt            iBatchCount;         ///< Number of entries used in iBatch
+    TBuf8<KBatchBufferSize> iBatchBuffer;        ///< Data of the messages in iBatch
+
+    CGameBTCommsRing *iSendQueue;        ///< Outgoing frames for all recipients, written from in place
+    TInt            iSendInFlight;       ///< Bytes of iSendQueue handed to iClient and not yet written
+    TUint8         *iLatestFrame[EToAll][KMaxLatestChannels]; ///< Unsent ELatestWins frame per recipient and channel
+    TQueueStatus    iQueueStatus[EToAll]; ///< Send queue occupancy per recipient
+    TInt            iSendVersion;        ///< Protocol version written to the link
+    TInt            iRecvVersion;        ///< Protocol version read from the link
+    TBool           iSendSwitch;         ///< ETrue until the version switch frame has been written
+    TUint8         *iWire[CMessageClient::KTransmitSlots];       ///< Protocol 2 transcodings of arena spans, NULL until needed
+    TPtrC8          iWireSource[CMessageClient::KTransmitSlots]; ///< Arena span each iWire buffer was made from
+    TInt            iWireHead;           ///< Oldest iWire buffer in flight
+    TInt            iWireCount;          ///< Number of iWire buffers in flight
+    CGameBTCommsDelta *iDeltaSend;       ///< References of coded messages sent, NULL unless enabled
+    CGameBTCommsDelta *iDeltaRecv;       ///< References of coded messages received
+    CGameBTCommsLz *iCompressor;         ///< Compresses blocks of frames, NULL unless enabled
+    TInt            iCapabilities;       ///< Capabilities accepted by the hub
+    TBool           iCrc;                ///< ETrue if CRC trailers are offered to the hub
+    TUint32         iCorruptBatches;     ///< Received batches that failed the CRC check
+    TUint32         iBadFragments;       ///< Received fragments longer than their message
+    TBool           iClock;              ///< ETrue if clock exchanges are offered to the hub
+    TInt            iClockInterval;      ///< Time in us between two clock requests
+    TTime           iClockSent;          ///< Time the last clock request was sent
+    TUint32         iClockOffset;        ///< Hub clock minus the local clock, in us modulo 2^32
+    TInt            iLatency;            ///< Estimated one way latency in us, negative if unknown
+    TUint32         iSampleOffset[KClockSamples]; ///< Offset measured by each of the last clock exchanges
+    TInt            iSampleDelay[KClockSamples];  ///< Round trip time of each of the last clock exchanges
+    TInt            iSampleCount;        ///< Number of clock exchanges made, saturates at KClockSamples
+    TInt            iSampleNext;         ///< Entry of iSampleOffset the next exchange goes to
+    TInt            iFrameStamp;         ///< Timestamp of the message being delivered, KErrNotFound if none
+    TUint16         iSendStamp;          ///< Timestamp of the frames being transcoded
+    TUint8          iBlock[KCompressBlock]; ///< Protocol 2 frames waiting to be compressed
+    HBufC8         *iReassembly[KMaxPlayers];       ///< Fragmented message being received per sender
+    HBufC8         *iReassemblyPool[KMaxPlayers];   ///< Preallocated iReassembly blocks in static memory mode
+    TBool           iStaticMemory;       ///< ETrue if no heap operation may happen after construction
+    char            iLine[KMaxLineLength]; ///< Registration line being sent
+    TInt            iReassemblyLength[KMaxPlayers]; ///< Announced length of iReassembly
 
-    char            iRecvBuffer[512];
-    TUint16         iRecvLength;
+    TFlushPolicy    iFlushPolicy;        ///< When to write queued frames
+    TFlushStats     iFlushStats;         ///< Flush counters
+    CPeriodic      *iFlushTimer;         ///< Enforces TFlushPolicy::iMaxDelay
+    TTime           iPendingSince;       ///< Time the oldest unsent frame was queued
+    TBool           iPending;            ///< ETrue if frames wait for a flush
+    TBool           iFlushDue;           ///< Set by Flush() or the flush timer
 
-    TMessageQueue   iMessageQueue[5];
+    CPeriodic      *iPumpTimer;          ///< Drives Update() at iPumpInterval
+    TInt            iPumpInterval;       ///< Time in us between two scheduled pumps, 0 if manual
+    TBool           iBudgeted;           ///< ETrue while Pump(TInt) runs
+    TTime           iDeadline;           ///< End of the budget of Pump(TInt)
+    TInt            iFramesLeft;         ///< Frames Pump(TInt) may still handle
 };
 
 #endif /* __GAMEBTCOMMS_H */
@@ -0,0 +1,44 @@
+/** @file GameBTCommsCrc.h
+ *
+ *  Table driven CRC-16 guarding batches of frames.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSCRC_H
+#define __GAMEBTCOMMSCRC_H
+
+#include <e32std.h>
+
+/**
+ * @name  Class TGameBTCommsCrc
+ *
+ * @class TGameBTCommsCrc
+ *
+ * @brief CRC-16/CCITT-FALSE (polynomial 1021h, initial value FFFFh, no
+ *        reflection), computed a byte at a time from a 512 byte table.
+ *        The ESP32 hub uses the same table.
+ */
+class TGameBTCommsCrc
+{
+public:
+    enum
+    {
+        KInitial = 0xffff ///< Value to start a new checksum with
+    };
+
+    /**
+     * @name  Crc16
+     *
+     * @fn    static TUint16 Crc16(const TUint8* aData, TInt aLength, TUint16 aCrc = KInitial)
+     *
+     * @brief Continues aCrc over aLength bytes at aData.
+     *
+     * @return The updated checksum.
+     */
+    static TUint16 Crc16(const TUint8 *aData, TInt aLength, TUint16 aCrc = KInitial);
+};
+
+#endif /* __GAMEBTCOMMSCRC_H */
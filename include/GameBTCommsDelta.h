@@ -0,0 +1,130 @@
+/** @file GameBTCommsDelta.h
+ *
+ *  Delta codec for payloads resent with few changes.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSDELTA_H
+#define __GAMEBTCOMMSDELTA_H
+
+#include <e32base.h>
+#include <e32std.h>
+#include "GameBTCommsProfile.h"
+
+/**
+ * @name  Class CGameBTCommsDelta
+ *
+ * @class CGameBTCommsDelta
+ *
+ * @brief Keeps the last payload of a number of slots and codes new
+ *        payloads as the run-length encoded XOR against it.
+ *
+ *        A coded payload starts with a tag byte: bit 7 is set for a
+ *        keyframe, which carries the payload as is; the other bits
+ *        are left to the owner to identify the slot.  The body of a
+ *        delta is a sequence of tokens: a byte with bit 7 set stands
+ *        for (bits 0 to 6) + 1 unchanged bytes, a byte with bit 7
+ *        clear is followed by (bits 0 to 6) + 1 bytes XORed into the
+ *        reference.
+ */
+class CGameBTCommsDelta : public CBase
+{
+public:
+    enum
+    {
+        KMaxLength   = GAMECOMMS_DELTA_SIZE, ///< Longest payload that is coded
+        KMaxChannels = 4,    ///< Channels per peer that are coded
+        KKeyframe    = 0x80, ///< Tag flag: the body is the payload itself
+        KBroadcast   = 0x40, ///< Tag flag: the payload was sent to all clients
+        KChannelMask = 0x03  ///< Tag bits holding the channel
+    };
+
+    /**
+     * @name  NewL
+     *
+     * @fn    static CGameBTCommsDelta* NewL(TInt aSlots, TInt aKeyInterval)
+     *
+     * @brief Creates a new codec.
+     *
+     * @param aSlots       Number of independent references.
+     *
+     * @param aKeyInterval Deltas between two keyframes of a slot, 0 to
+     *                     send keyframes only when required.
+     *
+     * @return A new CGameBTCommsDelta object.
+     */
+    static CGameBTCommsDelta *NewL(TInt aSlots, TInt aKeyInterval);
+    ~CGameBTCommsDelta();
+
+    /**
+     * @name  Encode
+     *
+     * @fn    TPtrC8 Encode(TInt aSlot, TUint8 aTag, const TDesC8& aData)
+     *
+     * @brief Codes aData against the reference of aSlot, which then
+     *        becomes aData.
+     *
+     *        A keyframe is produced if the slot has no reference of the
+     *        same length, the key interval is due or the delta would
+     *        not be smaller.
+     *
+     * @param aData At most KMaxLength bytes
+     *
+     * @return The tag and body, valid until the next call.
+     */
+    TPtrC8 Encode(TInt aSlot, TUint8 aTag, const TDesC8 &aData);
+
+    /**
+     * @name  Decode
+     *
+     * @fn    TBool Decode(TInt aSlot, TUint8 aTag, const TDesC8& aBody, TPtrC8& aData)
+     *
+     * @brief Applies a coded body to the reference of aSlot.
+     *
+     * @param aData Receives the payload, valid until the slot is used
+     *              again.
+     *
+     * @return EFalse if the body does not match the reference.  The
+     *         slot then waits for the next keyframe.
+     */
+    TBool Decode(TInt aSlot, TUint8 aTag, const TDesC8 &aBody, TPtrC8 &aData);
+
+    /**
+     * @name  Invalidate
+     *
+     * @fn    void Invalidate(TInt aSlot)
+     *
+     * @brief Drops the reference of aSlot, e.g. because the payload
+     *        coded against it was not sent.
+     */
+    void Invalidate(TInt aSlot);
+
+    /**
+     * @name  Reset
+     *
+     * @fn    void Reset()
+     *
+     * @brief Drops the references of all slots, e.g. because coded
+     *        payloads were lost on the link.  Every slot then waits for
+     *        its next keyframe.
+     */
+    void Reset();
+
+private:
+    CGameBTCommsDelta();
+    void ConstructL(TInt aSlots, TInt aKeyInterval);
+    TPtrC8 Keyframe(TInt aSlot, TUint8 aTag, const TDesC8 &aData);
+
+private:
+    TUint8 *iReference;   ///< KMaxLength bytes per slot
+    TInt   *iLength;      ///< Length of each reference, 0 if none
+    TInt   *iSinceKey;    ///< Deltas coded per slot since its last keyframe
+    TInt    iSlots;       ///< Number of slots
+    TInt    iKeyInterval; ///< Deltas between two keyframes, 0 if unlimited
+    TBuf8<1 + KMaxLength> iCoded; ///< Result of the last Encode()
+};
+
+#endif /* __GAMEBTCOMMSDELTA_H */
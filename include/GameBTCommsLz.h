@@ -0,0 +1,76 @@
+/** @file GameBTCommsLz.h
+ *
+ *  Byte oriented LZ compressor for batches of frames.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSLZ_H
+#define __GAMEBTCOMMSLZ_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+/**
+ * @name  Class CGameBTCommsLz
+ *
+ * @class CGameBTCommsLz
+ *
+ * @brief Compresses blocks of up to KMaxBlockSize bytes.
+ *
+ *        The output is a sequence of LZ4 style sequences: a token byte
+ *        holding the literal count (bits 4 to 7) and the match length
+ *        minus KMinMatch (bits 0 to 3), extended by bytes of 255 plus
+ *        a final byte if a field is 15; the literals; the match offset
+ *        (16 bit, little endian) and the extension of the match
+ *        length.  The last sequence ends after its literals.  Matches
+ *        are found through a single hash table probe, which keeps the
+ *        cost per byte low on the ARM9.
+ */
+class CGameBTCommsLz : public CBase
+{
+public:
+    enum
+    {
+        KMaxBlockSize = 512, ///< Largest input, the hub decompresses into a buffer of this size
+        KMinMatch     = 4,   ///< Shortest match worth a sequence
+        KHashBits     = 10   ///< log2 of the number of hash table entries
+    };
+
+    /**
+     * @name  NewL
+     *
+     * @fn    static CGameBTCommsLz* NewL()
+     *
+     * @brief Creates a new compressor.
+     *
+     * @return A new CGameBTCommsLz object.
+     */
+    static CGameBTCommsLz *NewL();
+
+    /**
+     * @name  Compress
+     *
+     * @fn    TInt Compress(const TUint8* aData, TInt aLength, TUint8* aOut, TInt aMaxLength)
+     *
+     * @brief Compresses aLength bytes at aData to aOut.
+     *
+     * @param aLength    At most KMaxBlockSize
+     *
+     * @param aMaxLength Room at aOut
+     *
+     * @return Compressed length, or 0 if the result would not fit.
+     */
+    TInt Compress(const TUint8 *aData, TInt aLength, TUint8 *aOut, TInt aMaxLength);
+
+private:
+    CGameBTCommsLz();
+    static TInt PutLength(TUint8 *aOut, TInt aLength);
+
+private:
+    TUint16 iHash[1 << KHashBits]; ///< Position + 1 of the last occurrence of each hash, 0 if none
+};
+
+#endif /* __GAMEBTCOMMSLZ_H */
@@ -379,4 +379,53 @@ public:
     virtual void ReceiveDataFromHost(TDesC8& aData) = 0;
 };
 
+/**
+ * @brief Describes one received message within a batch.
+ */
+typedef struct
+{
+    TUint16 iSender; ///< Client Id (host side) or KBTHostConnectionId (client side)
+    TUint16 iOffset; ///< Offset of the data within aBuffer
+    TUint16 iLength; ///< Length of the data
+
+} TGameBTCommsFrame;
+
+/**
+ * @class MGameBTCommsBatchNotify
+ *
+ * @brief Optional extension of MGameBTCommsNotify receiving all
+ *        messages of one pump with a single call.
+ *
+ *        Register an object implementing this interface with
+ *        CGameBTComms::SetBatchNotify.  While it is registered,
+ *        MGameBTCommsNotify::ReceiveDataFromClient and
+ *        MGameBTCommsNotify::ReceiveDataFromHost are no longer called;
+ *        games that do not register one keep receiving every message
+ *        through those.
+ */
+class MGameBTCommsBatchNotify
+{
+public:
+    /**
+     * @name  ReceiveBatch
+     *
+     * @fn    virtual void ReceiveBatch(const TDesC8& aBuffer, const TGameBTCommsFrame* aFrames, TInt aCount) = 0
+     *
+     * @brief Notifies the game application that data has been
+     *        received.
+     *
+     *        The messages are stored back to back in aBuffer.  Note
+     *        that it must be copied if it is to be used outside the
+     *        scope of this function.
+     *
+     * @param aBuffer Buffer holding the data of all messages
+     *
+     * @param aFrames Sender, offset and length of each message in
+     *                order of arrival
+     *
+     * @param aCount  Number of entries in aFrames
+     */
+    virtual void ReceiveBatch(const TDesC8& aBuffer, const TGameBTCommsFrame* aFrames, TInt aCount) = 0;
+};
+
 #endif // __GAMEBTCOMMSNOTIFY_H
@@ -0,0 +1,85 @@
+/** @file GameBTCommsProfile.h
+ *
+ *  Buffer sizes selected at compile time.
+ *
+ *  A game that sends little data does not need the buffers of a fast
+ *  paced shooter.  Define GAMECOMMS_PROFILE to one of the values below
+ *  when building the DLL to select a set of sizes; the build defaults
+ *  to GAMECOMMS_PROFILE_STANDARD.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSPROFILE_H
+#define __GAMEBTCOMMSPROFILE_H
+
+#define GAMECOMMS_PROFILE_LEAN     0 ///< Turn based and puzzle games
+#define GAMECOMMS_PROFILE_STANDARD 1 ///< Most games
+#define GAMECOMMS_PROFILE_LARGE    2 ///< Games sending state every frame
+
+#ifndef GAMECOMMS_PROFILE
+#define GAMECOMMS_PROFILE GAMECOMMS_PROFILE_STANDARD
+#endif
+
+#if GAMECOMMS_PROFILE == GAMECOMMS_PROFILE_LEAN
+
+#define GAMECOMMS_SEND_ARENA_SIZE   1024
+#define GAMECOMMS_RECV_BUFFER_SIZE  272
+#define GAMECOMMS_TX_BUFFER_SIZE    264
+#define GAMECOMMS_READ_BUFFER_SIZE  136
+#define GAMECOMMS_BATCH_BUFFER_SIZE 256
+#define GAMECOMMS_THREAD_RING_SIZE  4096
+#define GAMECOMMS_REASSEMBLY_SIZE   512
+#define GAMECOMMS_DELTA_SIZE        64
+#define GAMECOMMS_EXTRAS            0
+
+#elif GAMECOMMS_PROFILE == GAMECOMMS_PROFILE_STANDARD
+
+#define GAMECOMMS_SEND_ARENA_SIZE   4096
+#define GAMECOMMS_RECV_BUFFER_SIZE  1024
+#define GAMECOMMS_TX_BUFFER_SIZE    512
+#define GAMECOMMS_READ_BUFFER_SIZE  512
+#define GAMECOMMS_BATCH_BUFFER_SIZE 1024
+#define GAMECOMMS_THREAD_RING_SIZE  16384
+#define GAMECOMMS_REASSEMBLY_SIZE   1024
+#define GAMECOMMS_DELTA_SIZE        128
+#define GAMECOMMS_EXTRAS            1
+
+#elif GAMECOMMS_PROFILE == GAMECOMMS_PROFILE_LARGE
+
+#define GAMECOMMS_SEND_ARENA_SIZE   16384
+#define GAMECOMMS_RECV_BUFFER_SIZE  2048
+#define GAMECOMMS_TX_BUFFER_SIZE    1024
+#define GAMECOMMS_READ_BUFFER_SIZE  1024
+#define GAMECOMMS_BATCH_BUFFER_SIZE 4096
+#define GAMECOMMS_THREAD_RING_SIZE  65536
+#define GAMECOMMS_REASSEMBLY_SIZE   4096
+#define GAMECOMMS_DELTA_SIZE        254
+#define GAMECOMMS_EXTRAS            1
+
+#else
+#error Unknown GAMECOMMS_PROFILE
+#endif
+
+/* GAMECOMMS_EXTRAS: 1 compiles in the features of E:\GameComms.ini
+ * that are off by default and cost the most code, i.e. compressed
+ * blocks, clock exchanges and the comms thread.  Without them their
+ * settings are ignored and the hub is not offered the capabilities. */
+
+/* Largest protocol 2 transcoding of the send arena, the same as
+ * CGameBTComms::KWireBufferSize. */
+#define GAMECOMMS_WIRE_BUFFER_SIZE (5 + GAMECOMMS_SEND_ARENA_SIZE + GAMECOMMS_SEND_ARENA_SIZE / 2 + \
+                                    GAMECOMMS_SEND_ARENA_SIZE / 16 + 4)
+
+/* The receive buffer must hold the largest frame (6 + 255 bytes in
+ * protocol 2) and two reads, or the reader would pause whenever a
+ * single read is left unpolled, see CMessageClient::HasReadSpace().
+ * A thread ring must take one largest write while the other transmit
+ * slot holds one. */
+typedef char TGameBTCommsProfileCheck[((GAMECOMMS_RECV_BUFFER_SIZE >= 261) &&
+                                       (GAMECOMMS_RECV_BUFFER_SIZE >= 2 * GAMECOMMS_READ_BUFFER_SIZE) &&
+                                       (GAMECOMMS_THREAD_RING_SIZE >= 2 * GAMECOMMS_WIRE_BUFFER_SIZE)) ? 1 : -1];
+
+#endif /* __GAMEBTCOMMSPROFILE_H */
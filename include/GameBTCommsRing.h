@@ -0,0 +1,144 @@
+/** @file GameBTCommsRing.h
+ *
+ *  Contiguous ring arena holding variable-length records.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSRING_H
+#define __GAMEBTCOMMSRING_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+/**
+ * @name  Class CGameBTCommsRing
+ *
+ * @class CGameBTCommsRing
+ *
+ * @brief Single arena that stores records back to back.
+ *
+ *        Space is always handed out contiguously: if a record does not
+ *        fit between the write position and the end of the arena, the
+ *        remaining tail is skipped and the record is placed at the
+ *        start.  Readers therefore never see a record split across the
+ *        wrap point.
+ */
+class CGameBTCommsRing : public CBase
+{
+public:
+    /**
+     * @brief Writer position saved by Mark().
+     */
+    typedef struct
+    {
+        TInt iWrite;     ///< Offset where the next record was to be written
+        TInt iWatermark; ///< End of valid data at that time
+
+    } TMark;
+
+    /**
+     * @name  NewL
+     *
+     * @fn    static CGameBTCommsRing* NewL(TInt aSize)
+     *
+     * @brief Creates a new ring arena.
+     *
+     * @param aSize Size of the arena in bytes.
+     *
+     * @return A new CGameBTCommsRing object.
+     */
+    static CGameBTCommsRing *NewL(TInt aSize);
+    ~CGameBTCommsRing();
+
+    /**
+     * @name  Reserve
+     *
+     * @fn    TUint8* Reserve(TInt aLength)
+     *
+     * @brief Reserves contiguous space for a record.
+     *
+     *        The space becomes visible to the reader once Commit() is
+     *        called.  Only one reservation may be outstanding.
+     *
+     * @param aLength Number of bytes required.
+     *
+     * @return Pointer to the reserved space or NULL if the arena is
+     *         full.
+     */
+    TUint8 *Reserve(TInt aLength);
+
+    /**
+     * @name  Commit
+     *
+     * @fn    void Commit(TInt aLength)
+     *
+     * @brief Publishes the bytes written to the last reservation.
+     *
+     * @param aLength Number of bytes actually written.
+     */
+    void Commit(TInt aLength);
+
+    /**
+     * @name  Readable
+     *
+     * @fn    TPtrC8 Readable(TInt aOffset = 0) const
+     *
+     * @brief Returns the oldest contiguous span of committed bytes.
+     *
+     * @param aOffset Number of committed bytes to skip, e.g. because
+     *                they have already been handed out.
+     */
+    TPtrC8 Readable(TInt aOffset = 0) const;
+
+    /**
+     * @name  Consume
+     *
+     * @fn    void Consume(TInt aLength)
+     *
+     * @brief Releases bytes from the start of Readable().
+     */
+    void Consume(TInt aLength);
+
+    /**
+     * @name  Mark
+     *
+     * @fn    TMark Mark() const
+     *
+     * @brief Saves the writer position for Rewind().
+     */
+    TMark Mark() const;
+
+    /**
+     * @name  Rewind
+     *
+     * @fn    void Rewind(const TMark& aMark)
+     *
+     * @brief Takes back every record committed since Mark(), e.g.
+     *        because only part of a message fitted.  Nothing may have
+     *        been consumed in between.
+     *
+     * @param aMark Position returned by Mark().
+     */
+    void Rewind(const TMark &aMark);
+
+    TInt Size() const;     ///< Size of the arena in bytes
+    TInt Used() const;     ///< Number of committed bytes not yet consumed
+    TBool IsEmpty() const; ///< ETrue if no bytes are pending
+
+private:
+    CGameBTCommsRing();
+    void ConstructL(TInt aSize);
+
+private:
+    TUint8 *iArena;     ///< Backing store
+    TInt    iSize;      ///< Size of the backing store
+    TInt    iRead;      ///< Offset of the oldest committed byte
+    TInt    iWrite;     ///< Offset where the next record is written
+    TInt    iWatermark; ///< End of valid data while the writer has wrapped
+    TInt    iReserved;  ///< Offset of the outstanding reservation or -1
+};
+
+#endif /* __GAMEBTCOMMSRING_H */
@@ -0,0 +1,110 @@
+/** @file GameBTCommsSpsc.h
+ *
+ *  Lock-free byte ring shared by exactly one producer thread and one
+ *  consumer thread.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSSPSC_H
+#define __GAMEBTCOMMSSPSC_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+/**
+ * @name  Class CGameBTCommsSpsc
+ *
+ * @class CGameBTCommsSpsc
+ *
+ * @brief Byte ring handing data from one thread to another.
+ *
+ *        Write() may only be called by the producer, Readable(),
+ *        Read() and Consume() only by the consumer.  Each side owns
+ *        one index and only reads the other one, so no lock is
+ *        needed: the data is copied before the producer publishes its
+ *        index, and released before the consumer publishes its own.
+ *        The target is a single core ARM, where volatile accesses are
+ *        sufficient to keep this order.
+ */
+class CGameBTCommsSpsc : public CBase
+{
+public:
+    /**
+     * @name  NewL
+     *
+     * @fn    static CGameBTCommsSpsc* NewL(TInt aSize)
+     *
+     * @brief Creates a new ring.
+     *
+     * @param aSize Size of the ring in bytes.
+     *
+     * @return A new CGameBTCommsSpsc object.
+     */
+    static CGameBTCommsSpsc *NewL(TInt aSize);
+    ~CGameBTCommsSpsc();
+
+    /**
+     * @name  Write
+     *
+     * @fn    TInt Write(const TDesC8& aData)
+     *
+     * @brief Producer: copies as much of aData as fits.
+     *
+     * @return Number of bytes copied.
+     */
+    TInt Write(const TDesC8 &aData);
+
+    /**
+     * @name  Readable
+     *
+     * @fn    TPtrC8 Readable(TInt aOffset = 0) const
+     *
+     * @brief Consumer: returns the oldest contiguous span of data.
+     *
+     *        The span stays valid until it is consumed.
+     *
+     * @param aOffset Number of bytes to skip, e.g. because they have
+     *                already been handed out.
+     */
+    TPtrC8 Readable(TInt aOffset = 0) const;
+
+    /**
+     * @name  Read
+     *
+     * @fn    TInt Read(TDes8& aBuffer)
+     *
+     * @brief Consumer: appends as much data as fits to aBuffer and
+     *        consumes it.
+     *
+     * @return Number of bytes moved.
+     */
+    TInt Read(TDes8 &aBuffer);
+
+    /**
+     * @name  Consume
+     *
+     * @fn    void Consume(TInt aLength)
+     *
+     * @brief Consumer: releases bytes from the start of the ring.
+     */
+    void Consume(TInt aLength);
+
+    TInt Size() const;  ///< Size of the ring in bytes
+    TInt Used() const;  ///< Number of bytes written and not consumed
+    TInt Free() const;  ///< Number of bytes that can be written
+
+private:
+    CGameBTCommsSpsc();
+    void ConstructL(TInt aSize);
+
+private:
+    TUint8       *iRing;  ///< Backing store
+    TInt          iSize;  ///< Size of the backing store
+    volatile TInt iHead;  ///< Offset of the next byte written, owned by the producer
+    volatile TInt iTail;  ///< Offset of the oldest byte, owned by the consumer
+};
+
+#endif /* __GAMEBTCOMMSSPSC_H */
@@ -0,0 +1,117 @@
+/** @file GameBTCommsThread.h
+ *
+ *  Runs the Bluetooth link in a thread of its own.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __GAMEBTCOMMSTHREAD_H
+#define __GAMEBTCOMMSTHREAD_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+#include "MessageClient.h"
+
+class CGameBTCommsSpsc;
+
+/**
+ * @brief State shared between the game thread and the comms thread.
+ */
+typedef struct
+{
+    CGameBTCommsSpsc *iOutbound;   ///< Bytes to send, written by the game thread
+    CGameBTCommsSpsc *iInbound;    ///< Bytes received, written by the comms thread
+    TRequestStatus   *iWakeStatus; ///< Completed to wake the comms thread
+    TInt              iArmed;      ///< 1 while iWakeStatus may be completed, only changed with User::Locked*
+    volatile TBool    iConnected;  ///< Published by the comms thread
+    volatile TBool    iStop;       ///< Set by the game thread to end the comms thread
+    TMessageIoStats   iIoStats;    ///< Published by the comms thread, may be read while it changes
+    TInt              iInterval;   ///< Time in us between two status updates of the comms thread
+    TThreadId         iOwner;      ///< The game thread
+    TRequestStatus   *iStartStatus; ///< Completed in the game thread once the comms thread runs
+
+} TGameBTCommsShared;
+
+/**
+ * @name  Class CGameBTCommsThread
+ *
+ * @class CGameBTCommsThread
+ *
+ * @brief Game thread side of a CMessageClient running in its own
+ *        thread with its own active scheduler.
+ *
+ *        Data is exchanged through two CGameBTCommsSpsc rings, so
+ *        neither thread ever waits for the other.  Data passed to
+ *        WriteL() is copied into the outbound ring and reported back
+ *        through MMessageClientObserver::WriteComplete() from the
+ *        game's active scheduler.  Received data is only available
+ *        through PollMessagesL(); MMessageClientObserver::ReadComplete()
+ *        is never called.
+ */
+class CGameBTCommsThread : public CActive, public MMessageLink
+{
+public:
+    /**
+     * @name  NewL
+     *
+     * @fn    static CGameBTCommsThread* NewL(MMessageClientObserver* aObserver, TInt aRingSize, TInt aMaxWrite, TInt aInterval)
+     *
+     * @brief Creates the rings.  The thread is started by ConnectL().
+     *
+     * @param aObserver Receives write completions
+     * @param aRingSize Size of each ring in bytes
+     * @param aMaxWrite Largest single write, IsReadyToSendMessage()
+     *                  holds back until it fits into the outbound ring
+     * @param aInterval Time in us between two status updates of the
+     *                  comms thread
+     *
+     * @return A new CGameBTCommsThread object.
+     */
+    static CGameBTCommsThread *NewL(MMessageClientObserver *aObserver, TInt aRingSize, TInt aMaxWrite, TInt aInterval);
+    ~CGameBTCommsThread();
+
+    /* From MMessageLink */
+    TBool IsConnected();
+    TBool IsReadyToSendMessage();
+    void ConnectL();
+    void DisconnectL();
+    void SendMessageL(const TDesC8 &aMessage);
+    void WriteL(const TDesC8 &aData);
+    TBool PollMessagesL(TDes8 &aBuffer);
+    TInt BufferedLength() const;
+    const TMessageIoStats &IoStats() const;
+
+protected:
+    /* From CActive */
+    void RunL();
+    void DoCancel();
+
+private:
+    enum
+    {
+        KMaxCompletions = 2 ///< Writes reported back per RunL, as many as CMessageClient has slots
+    };
+
+    CGameBTCommsThread(MMessageClientObserver *aObserver, TInt aMaxWrite);
+    void ConstructL(TInt aRingSize, TInt aInterval);
+    void CopyL(const TDesC8 &aData);
+    void Wake();
+    void Stop();
+    static TInt ThreadFunction(TAny *aShared);
+    static void RunThreadL(TGameBTCommsShared &aShared);
+
+private:
+    MMessageClientObserver *iObserver;      ///< Receives write completions
+    TGameBTCommsShared      iShared;        ///< Rings and flags used by both threads
+    RThread                 iThread;        ///< The comms thread
+    TRequestStatus          iThreadStatus;  ///< Completed when the comms thread ends
+    TInt                    iMaxWrite;      ///< Largest single write, see NewL()
+    TBool                   iRunning;       ///< ETrue between ConnectL() and Stop()
+    TPtrC8                  iCompleted[KMaxCompletions]; ///< Copied writes not yet reported
+    TInt                    iCompletedCount; ///< Number of entries used in iCompleted
+};
+
+#endif /* __GAMEBTCOMMSTHREAD_H */
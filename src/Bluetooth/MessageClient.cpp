@@ -6,30 +6,33 @@ extern "C"
 #undef NULL
 }
 #include "MessageClient.h"
+#include "MessageReader.h"
 #include "MessageServiceSearcher.h"
 #include "BTPointToPoint.pan"
 
-_LIT8(KMessage, "Hello world");
-
-CMessageClient* CMessageClient::NewL()
+CMessageClient* CMessageClient::NewL(MMessageClientObserver* aObserver)
     {
-    CMessageClient* self = NewLC();
+    CMessageClient* self = NewLC(aObserver);
     CleanupStack::Pop(self);
     return self;
     }
     
-CMessageClient* CMessageClient::NewLC()
+CMessageClient* CMessageClient::NewLC(MMessageClientObserver* aObserver)
     {
-    CMessageClient* self = new (ELeave) CMessageClient();
+    CMessageClient* self = new (ELeave) CMessageClient(aObserver);
     CleanupStack::PushL(self);
-    self->ConstructL(KMessage);
+    self->ConstructL();
     return self;
     }
 
-CMessageClient::CMessageClient()
+CMessageClient::CMessageClient(MMessageClientObserver* aObserver)
 : CActive(CActive::EPriorityStandard),
-  iState(EWaitingToGetDevice)
+  iState(EWaitingToGetDevice),
+  iObserver(aObserver),
+  iTxHead(0),
+  iTxCount(0)
 {
+    memset(&iIoStats, 0, sizeof(iIoStats));
     CActiveScheduler::Add(this);
 }
 
@@ -37,27 +40,22 @@ CMessageClient::~CMessageClient()
     {
 
 	// Close() will wait forever for Read to complete
-	if (iState == EConnected)
-	{
-		iSendingSocket.CancelRead();
-	}
+    delete iReader;
+    iReader = NULL;
+
     Cancel();
 
     iSendingSocket.Close();
     iSocketServer.Close();
 
-    delete iMessage;
-    iMessage = NULL;
-
     delete iServiceSearcher;
     iServiceSearcher = NULL;
     }
 
-void CMessageClient::ConstructL(const TDesC8& aMessage)
+void CMessageClient::ConstructL()
     {
     iServiceSearcher = CMessageServiceSearcher::NewL();
-
-    iMessage = aMessage.AllocL();
+    iReader = CMessageReader::NewL(iSendingSocket, *this);
 
 	User::LeaveIfError(iSocketServer.Connect());
 
@@ -86,11 +84,6 @@ void CMessageClient::RunL()
                  // Connection error
                 iState = EWaitingToGetDevice;
                 break;
-			case EConnected:
-                // Lost connection
-				DisconnectFromServerL();
-				iState = EDisconnecting;
-				break;
             case ESendingMessage:
                 // Message Failed
 				DisconnectFromServerL();
@@ -134,25 +127,38 @@ void CMessageClient::RunL()
             case EGettingConnection:
                 // Connected
                 iState = EConnected;
-				// Catch disconnection event 
-				// By waiting to read socket
-                RequestData();
+				// Reads stay posted from here on, they also
+				// catch the disconnection event
+                iReader->Start();
                 break;
-			case EConnected:
-                // Data Recieved
-				// Just dump data
-				//iBuffer.Zero();
-                RequestData();
-				// Catch disconnection event 
-				// By waiting to read socket
-				break;
             case ESendingMessage:
-                // Sent message
-                iState = EConnected;
-				// Catch disconnection event 
-				// By waiting to read socket
-                RequestData();
+                {
+                // Sent message, the next queued one goes out immediately
+                TPtrC8 sent     = iTxData[iTxHead];
+                TBool  borrowed = iTxBorrowed[iTxHead];
+
+                iTxHead   = (iTxHead + 1) % KTransmitSlots;
+                iTxCount -= 1;
+
+                iIoStats.iWrites       += 1;
+                iIoStats.iBytesWritten += sent.Length();
+                UpdateWriteTime();
+
+                if (iTxCount > 0)
+                    {
+                    StartWrite();
+                    }
+                else
+                    {
+                    iState = EConnected;
+                    }
+
+                if (borrowed && iObserver)
+                    {
+                    iObserver->WriteComplete(sent, KErrNone);
+                    }
                 break;
+                }
             case EDisconnecting:
                 // Disconnection complete
 				iSendingSocket.Close();
@@ -196,7 +202,10 @@ void CMessageClient::DisconnectL()
 
 void CMessageClient::DisconnectFromServerL()
 	{
+	AbortWrites(KErrDisconnected);
+
 	// Terminate all operations
+	iReader->Cancel();
 	iSendingSocket.CancelAll();
 	Cancel();
   
@@ -225,41 +234,161 @@ void CMessageClient::ConnectToServerL()
     SetActive();
     }
 
-void CMessageClient::RequestData()
+void CMessageClient::SendMessageL(const TDesC8& aMessage)
     {
-    iSendingSocket.RecvOneOrMore(iBuffer, 0, iStatus, iLen);
-    SetActive();
+    QueueWriteL(aMessage, EFalse);
     }
 
-void CMessageClient::SendMessageL(const TDesC8& aMessage)
+void CMessageClient::WriteL(const TDesC8& aData)
+    {
+    QueueWriteL(aData, ETrue);
+    }
+
+void CMessageClient::QueueWriteL(const TDesC8& aData, TBool aBorrowed)
     {
-    if (iState != EConnected)
+    if (!IsConnected())
         {
         User::Leave(KErrDisconnected);
         }
 
-	// Stop reading socket
-	iSendingSocket.CancelRead();
-	if (IsActive()) 
-    {
-        Cancel();
+    if (iTxCount >= KTransmitSlots)
+        {
+        User::Leave(KErrOverflow);
+        }
+
+    TInt slot = (iTxHead + iTxCount) % KTransmitSlots;
+
+    if (aBorrowed)
+        {
+        iTxData[slot].Set(aData);
+        }
+    else
+        {
+        if (aData.Length() > KMaximumMessageLength)
+            {
+            User::Leave(KErrTooBig);
+            }
+        iTxBuffer[slot].Copy(aData);
+        iTxData[slot].Set(iTxBuffer[slot]);
+        }
+    iTxBorrowed[slot] = aBorrowed;
+    iTxCount += 1;
+
+    if (iState == EConnected)
+        {
+        // The read stays posted while writing
+        iState = ESendingMessage;
+        StartWrite();
+        }
     }
-    iMessage = aMessage.AllocL();
-    iState   = ESendingMessage;
-    iSendingSocket.Write(*iMessage, iStatus);
+
+void CMessageClient::StartWrite()
+    {
+    iWriteStarted.HomeTime();
+    iSendingSocket.Write(iTxData[iTxHead], iStatus);
     SetActive();
     }
 
-void CMessageClient::PollMessagesL(char aBuffer[KMaximumMessageLength], TUint16 & Length)
-{
-    memcpy(aBuffer, iBuffer.Ptr(), iBuffer.Length());
-    Length = iBuffer.Length();
-    iBuffer.Zero();
-}
+void CMessageClient::AbortWrites(TInt aError)
+    {
+    while (iTxCount > 0)
+        {
+        TPtrC8 data     = iTxData[iTxHead];
+        TBool  borrowed = iTxBorrowed[iTxHead];
+
+        iTxHead   = (iTxHead + 1) % KTransmitSlots;
+        iTxCount -= 1;
+
+        if (borrowed && iObserver)
+            {
+            iObserver->WriteComplete(data, aError);
+            }
+        }
+    }
+
+void CMessageClient::UpdateWriteTime()
+    {
+    TTime now;
+    now.HomeTime();
+
+    iIoStats.iLastWriteTime = (TUint32)now.MicroSecondsFrom(iWriteStarted).Int64().Low();
+    if (iIoStats.iLastWriteTime > iIoStats.iMaxWriteTime)
+        {
+        iIoStats.iMaxWriteTime = iIoStats.iLastWriteTime;
+        }
+    }
+
+TBool CMessageClient::HasReadSpace() const
+    {
+    return (iBuffer.MaxLength() - iBuffer.Length() >= CMessageReader::KReadBufferLength);
+    }
+
+TBool CMessageClient::DataReceived(const TDesC8& aData)
+    {
+    TPtrC8 rest(aData);
+    TInt   space;
+
+    iIoStats.iReads        += 1;
+    iIoStats.iBytesRead    += aData.Length();
+    iIoStats.iLastReadTime  = iReader->LastReadTime();
+
+    if (iObserver)
+        {
+        rest.Set(aData.Mid(iObserver->ReadComplete(aData)));
+        }
+
+    // Keep the data until it is polled.  Reads are only posted while a
+    // complete read fits, so nothing is dropped here in practice
+    space = iBuffer.MaxLength() - iBuffer.Length();
+    if (rest.Length() > space)
+        {
+        iIoStats.iBytesDropped += rest.Length() - space;
+        }
+    iBuffer.Append(rest.Left(Min(space, rest.Length())));
+
+    // Pause reading until PollMessagesL has made room
+    return HasReadSpace();
+    }
+
+void CMessageClient::ReadError(TInt /*aError*/)
+    {
+    if (IsConnected())
+        {
+        // Lost connection
+        DisconnectFromServerL();
+        iState = EDisconnecting;
+        }
+    }
+
+TInt CMessageClient::BufferedLength() const
+    {
+    return iBuffer.Length();
+    }
+
+const CMessageClient::TIoStats& CMessageClient::IoStats() const
+    {
+    return iIoStats;
+    }
+
+TBool CMessageClient::PollMessagesL(TDes8& aBuffer)
+    {
+    TInt length = Min(iBuffer.Length(), aBuffer.MaxLength() - aBuffer.Length());
+
+    aBuffer.Append(iBuffer.Left(length));
+    iBuffer.Delete(0, length);
+
+    // Resume reading if DataReceived paused it
+    if (IsConnected() && HasReadSpace())
+        {
+        iReader->Start();
+        }
+
+    return (iBuffer.Length() > 0);
+    }
 
 TBool CMessageClient::IsReadyToSendMessage()
     {
-	return (iState == EConnected);
+	return (IsConnected() && (iTxCount < KTransmitSlots));
     }
 
 TBool CMessageClient::IsConnected()
@@ -0,0 +1,70 @@
+/* Copyright (c) 2002, Nokia. All rights reserved */
+
+#include "MessageReader.h"
+
+CMessageReader* CMessageReader::NewL(RSocket& aSocket, MMessageReaderObserver& aObserver)
+    {
+    CMessageReader* self = new (ELeave) CMessageReader(aSocket, aObserver);
+    return self;
+    }
+
+CMessageReader::CMessageReader(RSocket& aSocket, MMessageReaderObserver& aObserver)
+: CActive(CActive::EPriorityStandard),
+  iSocket(aSocket),
+  iObserver(aObserver),
+  iLastReadTime(0)
+    {
+    CActiveScheduler::Add(this);
+    }
+
+CMessageReader::~CMessageReader()
+    {
+    Cancel();
+    }
+
+void CMessageReader::DoCancel()
+    {
+    iSocket.CancelRead();
+    }
+
+void CMessageReader::Start()
+    {
+    if (!IsActive())
+        {
+        RequestData();
+        }
+    }
+
+void CMessageReader::RequestData()
+    {
+    iPosted.HomeTime();
+    iSocket.RecvOneOrMore(iBuffer, 0, iStatus, iLen);
+    SetActive();
+    }
+
+void CMessageReader::RunL()
+    {
+    if (iStatus != KErrNone)
+        {
+        // Lost connection, the observer decides what happens next
+        iObserver.ReadError(iStatus.Int());
+        return;
+        }
+
+    TTime now;
+    now.HomeTime();
+
+    iLastReadTime = (TUint32)now.MicroSecondsFrom(iPosted).Int64().Low();
+
+    // Data the observer has no room for stays in the socket, which
+    // throttles the remote device instead of losing bytes
+    if (iObserver.DataReceived(iBuffer))
+        {
+        RequestData();
+        }
+    }
+
+TUint32 CMessageReader::LastReadTime() const
+    {
+    return iLastReadTime;
+    }
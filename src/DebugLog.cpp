@@ -16,22 +16,28 @@
 #if defined ENABLE_DEBUG_LOG
 void DebugLog(const char* filename, const char* format, ...)
 {
-    FILE*   log = NULL;
     va_list varg;
 
+    va_start(varg, format);
+    DebugLogV(filename, format, varg);
+    va_end(varg);
+}
+
+void DebugLogV(const char* filename, const char* format, va_list varg)
+{
+    FILE* log = NULL;
+
     log = fopen(filename, "a");
 
     if (log)
     {
-        va_start(varg, format);
         vfprintf(log, format, varg);
-        va_end(varg);
-
         fclose(log);
     }
 }
 #else
 
 void DebugLog(const char* filename, const char* format, ...) {}
+void DebugLogV(const char* filename, const char* format, va_list varg) {}
 
 #endif /* defined ENABLE_DEBUG_LOG */
\ No newline at end of file
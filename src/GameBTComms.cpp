@@ -24,6 +24,11 @@ extern "C"
 
 #include "GameBTComms.h"
 #include "GameBTCommsNotify.h"
+#include "GameBTCommsCrc.h"
+#include "GameBTCommsDelta.h"
+#include "GameBTCommsLz.h"
+#include "GameBTCommsRing.h"
+#include "GameBTCommsThread.h"
 #include "MessageClient.h"
 #include "DebugLog.h"
 
@@ -38,7 +43,7 @@ GLDEF_C TInt E32Dll(TDllReason /*aReason*/)
     return(KErrNone);
 }
 
-EXPORT_C CGameBTComms *CGameBTComms::NewL(MGameBTCommsNotify *aEventHandler, TUint32 aGameUID, RSGEDebugLog *aLog = NULL)
+EXPORT_C CGameBTComms *CGameBTComms::NewL(MGameBTCommsNotify *aEventHandler, TUint32 aGameUID, RSGEDebugLog *aLog)
 {
     CGameBTComms *pCGameBTComms = new CGameBTComms;
 
@@ -55,10 +60,31 @@ CGameBTComms::CGameBTComms()
 
 EXPORT_C CGameBTComms::~CGameBTComms()
 {
-    if (iClient->IsConnected())
+    /* NULL if ConstructL left before the client was created. */
+    if (iClient && iClient->IsConnected())
     {
         iClient->DisconnectL();
     }
+
+    for (TInt index = 0; index < KMaxPlayers; index += 1)
+    {
+        EndReassembly(index + 1);
+        delete iReassemblyPool[index];
+    }
+
+    delete iClientObject;
+
+    for (TInt slot = 0; slot < CMessageClient::KTransmitSlots; slot += 1)
+    {
+        User::Free(iWire[slot]);
+    }
+
+    delete iPumpTimer;
+    delete iFlushTimer;
+    delete iDeltaRecv;
+    delete iDeltaSend;
+    delete iCompressor;
+    delete iSendQueue;
 }
 
 EXPORT_C void CGameBTComms::StartHostL(TUint16 aStartPlayers, TUint16 aMinPlayers)
@@ -85,22 +111,16 @@ EXPORT_C void CGameBTComms::StartClientL()
 
 EXPORT_C CGameBTComms::TConnectionRole CGameBTComms::ConnectionRole()
 {
-    Update();
-
     return iConnectionRole;
 }
 
 EXPORT_C CGameBTComms::TGameState CGameBTComms::GameState()
 {
-    Update();
-
     return iGameState;
 }
 
 EXPORT_C CGameBTComms::TConnectState CGameBTComms::ConnectState()
 {
-    Update();
-
     return iConnectState;
 }
 
@@ -108,22 +128,102 @@ EXPORT_C TInt CGameBTComms::GetLocalDeviceName(THostName &aHostName)
 {
     TInt aError = KErrNone;
 
-    char device_name[32] = { 0 };
+    aHostName.Copy(TPtrC8((const TText8 *)iDeviceName));
+
+    return aError;
+}
+
+#if VERSION < 10
+
+EXPORT_C void CGameBTComms::Disconnect()
+{
+    Update();
+}
+
+#else
 
-    ini_gets("Config", "DeviceName", "bosley", (char *)device_name, 32, IniFile);
+EXPORT_C void CGameBTComms::Disconnect(TUint16 aClientId, TBool aPermanently)
+{
+    Update();
+}
 
-    aHostName.Copy(TPtrC8((const TText8 *)device_name));
+EXPORT_C TInt CGameBTComms::Connect()
+{
+    TInt aError = KErrNone;
 
     Update();
 
     return aError;
 }
 
-EXPORT_C void CGameBTComms::Disconnect()
+/* The hub finds and pairs the remote devices itself. */
+EXPORT_C TInt CGameBTComms::DeclareRemoteDevice(const TDeviceDetails &aDevice)
+{
+    TInt aError = KErrNone;
+
+    return aError;
+}
+
+/* The radio belongs to the hub, it is always on. */
+EXPORT_C TInt CGameBTComms::SetBluetoothPowerState(TBool aState)
+{
+    TInt aError = KErrNone;
+
+    return aError;
+}
+
+EXPORT_C void CGameBTComms::SetLocalDeviceName(THostName aHostName)
+{
+    TInt length = Min(aHostName.Length(), (TInt)sizeof(iDeviceName) - 1);
+
+    /* Sent with the next registration. */
+    for (TInt index = 0; index < length; index += 1)
+    {
+        iDeviceName[index] = (char)aHostName[index];
+    }
+    iDeviceName[length] = '\0';
+}
+
+EXPORT_C void CGameBTComms::BluetoothPowerState(TBool aState)
+{
+}
+
+EXPORT_C void CGameBTComms::EndSession()
+{
+    EndMultiPlayerGame();
+}
+
+EXPORT_C void CGameBTComms::SendData(TUint16 aClientId, TPtr8 aData)
+{
+    if (iConnectionRole == EClient)
+    {
+        SendDataToHost(aData);
+    }
+    else if (aClientId == 0)
+    {
+        SendDataToAllClients(aData);
+    }
+    else
+    {
+        SendDataToClient(aClientId, aData);
+    }
+}
+
+/* Discovery, searching and accepting clients are up to the hub. */
+EXPORT_C void CGameBTComms::SetDiscoverabilityModeLimited(TBool aMode)
 {
-    Update();
 }
 
+EXPORT_C void CGameBTComms::SetHostAcceptMode(THostAcceptMode aMode)
+{
+}
+
+EXPORT_C void CGameBTComms::SetSearchModeLimited(TBool aMode)
+{
+}
+
+#endif /* VERSION < 10 */
+
 EXPORT_C TInt CGameBTComms::DisconnectClient(TUint16 aClientId)
 {
     TInt aError = KErrNone;
@@ -135,26 +235,54 @@ EXPORT_C TInt CGameBTComms::DisconnectClient(TUint16 aClientId)
 
 EXPORT_C TInt CGameBTComms::SendDataToClient(TUint16 aClientId, TDesC8 &aData)
 {
-    TInt aError = KErrNone;
+    TInt aError = Enqueue(ClientRecipient(aClientId), aData);
+
+    SendQueued();
 
-    Update(aClientId, (char *)aData.Ptr(), aData.Length(), __FUNCTION__);
     return aError;
 }
 
 EXPORT_C TInt CGameBTComms::SendDataToAllClients(TDesC8 &aData)
 {
-    TInt aError = KErrNone;
+    TInt aError = Enqueue(EToAll, aData);
 
-    Update(EToAll, (char *)aData.Ptr(), aData.Length(), __FUNCTION__);
+    SendQueued();
 
     return aError;
 }
 
 EXPORT_C TInt CGameBTComms::SendDataToHost(TDesC8 &aData)
 {
-    TInt aError = KErrNone;
+    TInt aError = Enqueue(EToHost, aData);
+
+    SendQueued();
+
+    return aError;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::SendDataToClient(TUint16 aClientId, TDesC8 &aData, TSendLane aLane, TUint8 aChannel)
+{
+    TInt aError = Enqueue(ClientRecipient(aClientId), aData, aLane, aChannel);
+
+    SendQueued();
+
+    return aError;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::SendDataToAllClients(TDesC8 &aData, TSendLane aLane, TUint8 aChannel)
+{
+    TInt aError = Enqueue(EToAll, aData, aLane, aChannel);
+
+    SendQueued();
 
-    Update(EToHost, (char *)aData.Ptr(), aData.Length());
+    return aError;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::SendDataToHost(TDesC8 &aData, TSendLane aLane, TUint8 aChannel)
+{
+    TInt aError = Enqueue(EToHost, aData, aLane, aChannel);
+
+    SendQueued();
 
     return aError;
 }
@@ -168,7 +296,7 @@ EXPORT_C TInt CGameBTComms::ContinueMultiPlayerGame()
     return aError;
 }
 
-EXPORT_C TInt CGameBTComms::ReconnectL(TBool aMustReconnectToAll = ETrue)
+EXPORT_C TInt CGameBTComms::ReconnectL(TBool aMustReconnectToAll)
 {
     TInt aError = KErrNone;
 
@@ -199,191 +327,1911 @@ EXPORT_C TBool CGameBTComms::IsShowingDeviceSelectDlg()
 {
     TBool aState = EFalse;
 
-    Update();
-
     return aState;
 }
 
-void CGameBTComms::Update(TUint16 aClientId = EInvalid, const char *aData = NULL, TUint16 aLength = 0, const char *sDebug = NULL)
+TInt CGameBTComms::Enqueue(TUint16 aRecipient, const TDesC8 &aData, TSendLane aLane, TUint8 aChannel)
 {
-    char    buffer[512] = { 0 };
-    TUint16 offset = 0;
+    const TUint8 *data   = aData.Ptr();
+    TInt          length = aData.Length();
+    TUint8      **latest = NULL;
+    TUint8        header = (TUint8)aRecipient;
+    TInt          slot   = -1;
+    TUint8       *frame;
+
+    if ((aRecipient < EToHost) || (aRecipient > EToAll) || (length == 0))
+    {
+        return KErrArgument;
+    }
 
-    if ((aLength > 0) && (aClientId != EInvalid))
+    if (length > KMaxMessageLength)
     {
-        TUint8 pos                      = iMessageQueue[aClientId - 1].Pos;
-        TUint8 message[KMaxMessageSize] = { 0 };
+        Log("Error: message of %d bytes exceeds %u.\n", length, KMaxMessageLength);
+        return KErrTooBig;
+    }
 
+    /* Protocol 1 hubs do not know the fragment flags, a message must
+     * fit a single frame until the hub has accepted protocol 2. */
+    if ((iSendVersion == 1) && (length > KMaxPayloadLength))
+    {
+        Log("Error: message of %d bytes needs protocol 2.\n", length);
+        return KErrTooBig;
+    }
 
-        if (pos >= KMaxQueueSize)
+    if (aLane == ELatestWins)
+    {
+        if (aChannel >= KMaxLatestChannels)
         {
-            DebugLog(LOG, "Error: queue %u full.\n", pos);
-            return;
+            return KErrArgument;
         }
 
-        if (aLength >= KMaxMessageSize - 3)
+        if (length > KMaxPayloadLength)
         {
-            DebugLog(LOG, "Error: message to big. Increase queue size.\n");
+            /* Snapshots are replaced as a whole, they must fit a single frame. */
+            return KErrTooBig;
         }
 
-        message[0] = aClientId;
-        message[1] = aLength;
-        for (TInt index = 2; index < aLength + 2; index += 1)
+        latest = &iLatestFrame[aRecipient - 1][aChannel];
+
+        if (*latest)
         {
-            message[index] = aData[index - 2];
+            if ((*latest)[1] == length)
+            {
+                /* Same size: overwrite the stale snapshot in place. */
+                memcpy(&(*latest)[KFrameHeaderSize], data, length);
+                return KErrNone;
+            }
+
+            /* Size changed: void the stale frame, the hub discards
+             * frames addressed to 00h.  Its payload must not start with
+             * a control marker or it would be taken for one. */
+            iQueueStatus[aRecipient - 1].iQueuedBytes  -= KFrameOverhead + (*latest)[1];
+            iQueueStatus[aRecipient - 1].iQueuedFrames -= 1;
+
+            (*latest)[0] = 0x00;
+            if ((*latest)[1] > 0)
+            {
+                (*latest)[KFrameHeaderSize] = KVoidMarker;
+            }
+            *latest      = NULL;
         }
-        message[aLength + 2] = '\n';
+    }
+
+    /* Replaced snapshots never reach the peer, so only the reliable
+     * lane is delta coded.  The hub must speak protocol 2 to pass the
+     * flag on. */
+    if (iDeltaSend && (aLane == EReliableOrdered) && (iSendVersion > 1) &&
+        (aChannel < CGameBTCommsDelta::KMaxChannels) && (length <= CGameBTCommsDelta::KMaxLength))
+    {
+        TUint8 tag   = aChannel | ((aRecipient == EToAll) ? CGameBTCommsDelta::KBroadcast : 0);
+        TPtrC8 coded;
 
-        memcpy(&iMessageQueue[aClientId - 1].Queue[pos], message, aLength + 3);
-        iMessageQueue[aClientId - 1].Length[pos]  = aLength + 3;
-        iMessageQueue[aClientId - 1].Pos         += 1;
+        slot  = (aRecipient - 1) * CGameBTCommsDelta::KMaxChannels + aChannel;
+        coded.Set(iDeltaSend->Encode(slot, tag, aData));
+
+        data    = coded.Ptr();
+        length  = coded.Length();
+        header |= KDeltaCoded;
     }
 
-    if (iClient->IsReadyToSendMessage() == EFalse)
+    /* Multicast frames are protocol 2 as well, before that every
+     * recipient gets its own frame. */
+    if ((! latest) && (slot < 0) && (iSendVersion > 1) && (aRecipient >= EToClient1) && (aRecipient <= EToClient3) &&
+        (length <= KMaxPayloadLength) && Coalesce((TUint8)aRecipient, aData))
     {
-        return;
+        return KErrNone;
     }
 
-    switch (iGameCommsState)
+    if (length <= KMaxPayloadLength)
     {
-        case EInit:
+        frame = AppendFrame(header, NULL, 0, data, length);
+        if (! frame)
         {
-            if (iClient->IsReadyToSendMessage() && aLength == 0)
+            if (slot >= 0)
             {
-                iGameCommsState = ERegisterUID;
+                /* The peer never sees this payload, start over with a keyframe. */
+                iDeltaSend->Invalidate(slot);
             }
-            break;
+            return KErrOverflow;
         }
-        case ERegisterUID:
+
+        if (latest)
         {
-            sprintf(buffer, (const char *)"UID:0x%08X\n", (unsigned int)iGameUID);
-            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
-            iGameCommsState = ERegisterDeviceName;
-            break;
+            *latest = frame;
         }
-        case ERegisterDeviceName:
+    }
+    else
+    {
+        /* Fragment: the first frame is prefixed with the total length,
+         * the receiver reassembles before calling ReceiveDataFrom*. */
+        TUint8                  total[2];
+        TInt                    fragments = (length + 2 + KMaxPayloadLength - 1) / KMaxPayloadLength;
+        TInt                    offset    = 0;
+        CGameBTCommsRing::TMark mark      = iSendQueue->Mark();
+        TQueueStatus            status    = iQueueStatus[aRecipient - 1];
+
+        if (fragments * KFrameOverhead + length + 2 > iSendQueue->Size() - iSendQueue->Used())
         {
-            if (aLength == 0)
-            {
-                char device_name[32] = { 0 };
+            Log("Error: send queue full (%d of %d bytes used).\n", iSendQueue->Used(), iSendQueue->Size());
+            return KErrOverflow;
+        }
 
-                ini_gets("Config", "DeviceName", "bosley", (char *)device_name, 32, IniFile);
+        total[0] = (TUint8)(length & 0xff);
+        total[1] = (TUint8)(length >> 8);
 
-                sprintf(buffer, (const char *)"DID:%s\n", device_name);
+        while (offset < length)
+        {
+            TInt   prefix = (offset == 0) ? 2 : 0;
+            TInt   chunk  = Min(length - offset, KMaxPayloadLength - prefix);
+            TUint8 header = (TUint8)aRecipient;
 
-                iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
-                iGameCommsState = ERegisterNetConfig;
+            if (offset > 0)
+            {
+                header |= KFragmentNext;
             }
-            break;
-        }
-        case ERegisterNetConfig:
-        {
-            if (aLength == 0)
+            if (offset + chunk < length)
             {
-                char host[32] = { 0 };
-                long port = ini_getbool("Network", "Port", 8889, IniFile);
-
-                ini_gets("Network", "Host", "localhost", (char *)host, 32, IniFile);
-
-                sprintf(buffer, (const char *)"NET:%s:%u\n", host, (unsigned short)port);
+                header |= KFragmentMore;
+            }
 
-                iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
-                iGameCommsState = ERegisterRole;
+            if (! AppendFrame(header, total, prefix, data + offset, chunk))
+            {
+                /* The free space is not contiguous.  Take back the
+                 * fragments queued so far, none of the message is sent. */
+                iSendQueue->Rewind(mark);
+                iQueueStatus[aRecipient - 1] = status;
+                return KErrOverflow;
             }
-            break;
+
+            offset += chunk;
         }
-        case ERegisterRole:
-            if (aLength == 0)
-            {
-                char role;
+    }
 
-                if (iConnectionRoleTemp == EHost)
-                {
-                    role = 'H';
-                }
-                else
-                {
-                    role = 'C';
-                }
+    if (! iPending)
+    {
+        iPending = ETrue;
+        iPendingSince.HomeTime();
+        StartFlushTimer();
+    }
 
-                sprintf(buffer, (const char *)"ROL:%c\n", role);
+    return KErrNone;
+}
 
-                iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+TUint16 CGameBTComms::ClientRecipient(TUint16 aClientId)
+{
+    /* Client Id 1 is addressed as 02h on the wire. */
+    if ((aClientId < 1) || (aClientId > EToClient3 - 1))
+    {
+        return EInvalid;
+    }
 
-                iNotify->StartMultiPlayerGame(KErrNone);
+    return aClientId + 1;
+}
 
-                iGameState      = EPlay;
-                iGameCommsState = EHandleMessages;
-            }
-            break;
-        case EHandleMessages:
-            iConnectionRole = iConnectionRoleTemp; /* Asign selected connection role */
+TBool CGameBTComms::Reaches(TUint8 aTarget, TUint8 aRecipient)
+{
+    if ((aTarget == aRecipient) || (aTarget == EToAll))
+    {
+        return ETrue;
+    }
+
+    if ((aTarget & KRecipientMulticast) && (aRecipient >= EToClient1))
+    {
+        return (aTarget & (1 << (aRecipient - EToClient1))) != 0;
+    }
+
+    return EFalse;
+}
+
+TBool CGameBTComms::Coalesce(TUint8 aRecipient, const TDesC8 &aData)
+{
+    TUint8 *candidate = NULL;
+    TInt    offset    = iSendInFlight;
+    TPtrC8  span      = iSendQueue->Readable(offset);
+
+    /* Look for the same payload queued for other clients and not yet
+     * handed to the socket.  A later frame reaching aRecipient rules
+     * out every earlier candidate, merging would reorder its messages. */
+    while (span.Length() > 0)
+    {
+        for (TInt index = 0; index < span.Length(); index += KFrameOverhead + span[index + 1])
+        {
+            TUint8 *frame  = (TUint8 *)span.Ptr() + index;
+            TUint8  target = frame[0] & KRecipientMask;
 
-            /* Handle pending messages. */
-            for (TInt queueIndex = 0; queueIndex < EToAll; queueIndex += 1)
+            if (Reaches(target, aRecipient))
             {
-                for (TInt msgIndex = 0; msgIndex < iMessageQueue[queueIndex].Pos; msgIndex += 1)
-                {
-                    TUint8 *queue  = iMessageQueue[queueIndex].Queue[msgIndex];
-                    TUint8  length = iMessageQueue[queueIndex].Length[msgIndex];
-
-                    if (length > 0)
-                    {
-                        for (TInt bufIndex = 0; bufIndex < length; bufIndex += 1)
-                        {
-                            buffer[offset] = queue[bufIndex];
-                            offset += 1;
-                        }
-                    }
-                }
-                iMessageQueue[queueIndex].Pos = 0;
+                candidate = NULL;
             }
-
-            if (offset > 1)
+            else if ((! (frame[0] & (KFragmentMore | KFragmentNext | KDeltaCoded))) &&
+                     (((target >= EToClient1) && (target <= EToClient3)) || (target & KRecipientMulticast)) &&
+                     (frame[1] == aData.Length()) &&
+                     (memcmp(&frame[KFrameHeaderSize], aData.Ptr(), aData.Length()) == 0) &&
+                     (LatestChannel(frame) < 0))
             {
-                iClient->SendMessageL(TPtrC8((const TUint8 *)buffer, offset));
+                candidate = frame;
             }
+        }
 
-            /* Handle incoming messages. Work-in-progress. */
-            iClient->PollMessagesL(iRecvBuffer, iRecvLength);
+        offset += span.Length();
+        span.Set(iSendQueue->Readable(offset));
+    }
 
-            if (iRecvLength > 0 && iRecvBuffer[iRecvLength - 1] == '\n')
-            {
-                for (TInt index = 2; index < iRecvLength - 1; index += 1)
-                {
-                    buffer[index - 2] = iRecvBuffer[index]; // Cut-off header and trailing new line.
-                }
+    if (! candidate)
+    {
+        return EFalse;
+    }
 
-                if (iConnectionRole == EHost)
-                {
-                    /* TEST */
-                    iNotify->ReceiveDataFromClient((TUint16)iRecvBuffer[0], TPtrC8((const TUint8 *)buffer, iRecvLength - 3));
-                }
-                else if (iConnectionRole == EClient)
-                {
-                    /* TEST */
-                    iNotify->ReceiveDataFromHost(TPtrC8((const TUint8 *)buffer, iRecvLength - 3));
-                }
-            }
-            break;
+    if (! (candidate[0] & KRecipientMulticast))
+    {
+        candidate[0] = (TUint8)(KRecipientMulticast | (1 << (candidate[0] - EToClient1)));
     }
+    candidate[0] |= (TUint8)(1 << (aRecipient - EToClient1));
+
+    AddQueued(aRecipient, KFrameOverhead + aData.Length());
+
+    return ETrue;
 }
 
-void CGameBTComms::ConstructL(MGameBTCommsNotify *aEventHandler, TUint32 aGameUID, RSGEDebugLog *aLog)
+void CGameBTComms::AddQueued(TUint8 aRecipient, TInt aBytes)
 {
-    iNotify             = aEventHandler;
-    iGameUID            = aGameUID;
-    iLog                = aLog;
-    iConnectionRole     = EIdle;
-    iConnectionRoleTemp = EIdle;
-    iConnectState       = ENotConnected;
-    iGameState          = EGameOver;
-    iClient             = CMessageClient::NewL();
-    iRecvLength         = 0;
+    TQueueStatus *status = &iQueueStatus[aRecipient - 1];
+
+    status->iQueuedBytes  += aBytes;
+    status->iQueuedFrames += 1;
+    if (status->iQueuedBytes > status->iHighWaterMark)
+    {
+        status->iHighWaterMark = status->iQueuedBytes;
+    }
+}
+
+TUint8 *CGameBTComms::AppendFrame(TUint8 aHeader, const TUint8 *aPrefix, TInt aPrefixLength, const TUint8 *aData, TInt aLength)
+{
+    TInt          payload = aPrefixLength + aLength;
+    TUint8       *frame;
+
+    /* The frame is laid out exactly as it goes on the wire: the
+     * header is written once and the payload is copied once. */
+    frame = iSendQueue->Reserve(KFrameOverhead + payload);
+    if (! frame)
+    {
+        Log("Error: send queue full (%d of %d bytes used).\n", iSendQueue->Used(), iSendQueue->Size());
+        return NULL;
+    }
+
+    frame[0] = aHeader;
+    frame[1] = (TUint8)payload;
+    memcpy(&frame[KFrameHeaderSize], aPrefix, aPrefixLength);
+    memcpy(&frame[KFrameHeaderSize + aPrefixLength], aData, aLength);
+    frame[KFrameHeaderSize + payload] = '\n';
+    iSendQueue->Commit(KFrameOverhead + payload);
+
+    AddQueued(aHeader & KRecipientMask, KFrameOverhead + payload);
+
+    return frame;
+}
+
+void CGameBTComms::ReceiveFrame(TUint8 aHeader, const TDesC8 &aPayload)
+{
+    TUint8  sender = aHeader & KRecipientMask;
+    HBufC8 *message;
+
+    if ((sender < EToHost) || (sender > KMaxPlayers))
+    {
+        return;
+    }
+
+    if (! (aHeader & (KFragmentMore | KFragmentNext)))
+    {
+        /* A new message cancels an incomplete one from the same device. */
+        EndReassembly(sender);
+
+        if (aHeader & KDeltaCoded)
+        {
+            ReceiveDelta(sender, aPayload);
+        }
+        else
+        {
+            Deliver(sender, aPayload);
+        }
+        return;
+    }
+
+    if (! (aHeader & KFragmentNext))
+    {
+        TInt total;
+
+        EndReassembly(sender);
+
+        if (aPayload.Length() < 2)
+        {
+            return;
+        }
+
+        total = aPayload[0] | (aPayload[1] << 8);
+        if (aPayload.Length() - 2 > total)
+        {
+            Log("Error: fragment from %u exceeds the announced %d bytes.\n", sender, total);
+            iBadFragments += 1;
+            return;
+        }
+
+        message = StartReassembly(sender, total);
+        if (! message)
+        {
+            return;
+        }
+
+        message->Des().Copy(aPayload.Mid(2));
+    }
+    else
+    {
+        message = iReassembly[sender - 1];
+        if (! message)
+        {
+            return; /* Start of the message was lost. */
+        }
+
+        if (message->Length() + aPayload.Length() > iReassemblyLength[sender - 1])
+        {
+            Log("Error: fragment from %u exceeds the announced %d bytes.\n", sender, iReassemblyLength[sender - 1]);
+            iBadFragments += 1;
+            EndReassembly(sender);
+            return;
+        }
+
+        message->Des().Append(aPayload);
+    }
 
-    for (TInt aIndex = 0; aIndex <= EToAll; aIndex += 1)
+    if (! (aHeader & KFragmentMore))
     {
-        memset(&iMessageQueue[aIndex], 0, sizeof(TMessageQueue));
+        message = iReassembly[sender - 1];
+
+        if (message->Length() == iReassemblyLength[sender - 1])
+        {
+            Deliver(sender, *message);
+        }
+        EndReassembly(sender);
+    }
+}
+
+void CGameBTComms::ReceiveDelta(TUint8 aSender, const TDesC8 &aPayload)
+{
+    TPtrC8 data;
+    TUint8 tag;
+    TInt   slot;
+
+    if (aPayload.Length() < 1)
+    {
+        return;
+    }
+
+    /* References are kept per sender, channel and whether the message
+     * was broadcast, as the sender keeps them per recipient. */
+    tag  = aPayload[0];
+    slot = (aSender - 1) * 2 + ((tag & CGameBTCommsDelta::KBroadcast) ? 1 : 0);
+    slot = slot * CGameBTCommsDelta::KMaxChannels + (tag & CGameBTCommsDelta::KChannelMask);
+
+    if (iDeltaRecv->Decode(slot, tag, aPayload.Mid(1), data))
+    {
+        Deliver(aSender, data);
+    }
+    else
+    {
+        Log("Error: delta coded message from %u dropped, waiting for a keyframe.\n", aSender);
+    }
+}
+
+HBufC8 *CGameBTComms::StartReassembly(TUint8 aSender, TInt aLength)
+{
+    HBufC8 *message;
+
+    if (iStaticMemory)
+    {
+        message = iReassemblyPool[aSender - 1];
+        if (aLength > message->Des().MaxLength())
+        {
+            Log("Error: %d bytes exceed the reassembly block.\n", aLength);
+            return NULL;
+        }
+        message->Des().Zero();
+    }
+    else
+    {
+        message = HBufC8::New(aLength);
+        if (! message)
+        {
+            Log("Error: no memory to reassemble %d bytes.\n", aLength);
+            return NULL;
+        }
+    }
+
+    iReassembly[aSender - 1]       = message;
+    iReassemblyLength[aSender - 1] = aLength;
+
+    return message;
+}
+
+void CGameBTComms::EndReassembly(TUint8 aSender)
+{
+    HBufC8 *message = iReassembly[aSender - 1];
+
+    iReassembly[aSender - 1] = NULL;
+
+    if (message != iReassemblyPool[aSender - 1])
+    {
+        delete message;
+    }
+}
+
+TBool CGameBTComms::GameSenderId(TUint8 aSender, TUint16 &aId) const
+{
+    if ((iConnectionRole == EHost) && (aSender >= EToClient1))
+    {
+        /* Client 1 is sent as 02h but known to the game as Id 1. */
+        aId = aSender - 1;
+        return ETrue;
+    }
+    else if ((iConnectionRole == EClient) && (aSender == EToHost))
+    {
+        aId = KServerConnectionId;
+        return ETrue;
+    }
+
+    return EFalse;
+}
+
+void CGameBTComms::Deliver(TUint8 aSender, const TDesC8 &aData)
+{
+    TGameBTCommsFrame *frame;
+    TUint16            id;
+
+    if (! GameSenderId(aSender, id))
+    {
+        return;
+    }
+
+    if (! iBatchNotify)
+    {
+        Dispatch(id, aData);
+        return;
+    }
+
+    if ((iBatchCount == KMaxBatchFrames) ||
+        (aData.Length() > iBatchBuffer.MaxLength() - iBatchBuffer.Length()))
+    {
+        FlushBatch();
+    }
+
+    if (aData.Length() > iBatchBuffer.MaxLength())
+    {
+        /* Too large to be copied, passed on as a batch of its own. */
+        TGameBTCommsFrame single;
+
+        single.iSender = id;
+        single.iOffset = 0;
+        single.iLength = (TUint16)aData.Length();
+
+        iBatchNotify->ReceiveBatch(aData, &single, 1);
+        return;
+    }
+
+    frame = &iBatch[iBatchCount];
+    frame->iSender = id;
+    frame->iOffset = (TUint16)iBatchBuffer.Length();
+    frame->iLength = (TUint16)aData.Length();
+    iBatchCount += 1;
+
+    iBatchBuffer.Append(aData);
+}
+
+void CGameBTComms::FlushBatch()
+{
+    TInt count = iBatchCount;
+
+    if (count > 0)
+    {
+        iBatchCount = 0;
+        iBatchNotify->ReceiveBatch(iBatchBuffer, iBatch, count);
+        iBatchBuffer.Zero();
+    }
+}
+
+void CGameBTComms::Dispatch(TUint16 aId, const TDesC8 &aData)
+{
+    TPtrC8 data(aData);
+
+    if (iConnectionRole == EHost)
+    {
+        iNotify->ReceiveDataFromClient(aId, data);
+    }
+    else if (iConnectionRole == EClient)
+    {
+        iNotify->ReceiveDataFromHost(data);
+    }
+}
+
+void CGameBTComms::ReceivePendingL()
+{
+    if (iDecoding)
+    {
+        /* Called from within a ReceiveDataFrom* callback. */
+        return;
+    }
+
+    iDecoding = ETrue;
+    DrainClientL();
+
+    /* Everything decoded in this pump goes out as one batch. */
+    FlushBatch();
+    iDecoding = EFalse;
+}
+
+void CGameBTComms::DrainClientL()
+{
+    TBool more;
+
+    do
+    {
+        more = iClient->PollMessagesL(iRecvBuffer);
+
+        /* Keep the partial frame at the start of the buffer. */
+        iRecvBuffer.Delete(0, DecodeFrames(iRecvBuffer));
+    }
+    while (more && (! BudgetSpent()));
+}
+
+TInt CGameBTComms::DecodeFrames(const TDesC8 &aData)
+{
+    TInt offset = 0;
+
+    while (offset < aData.Length())
+    {
+        TInt used;
+
+        if ((iRecvVersion > 1) && (iCapabilities & KCapCrc))
+        {
+            used = DecodeBatch(aData.Mid(offset));
+        }
+        else
+        {
+            used = DecodeRun(aData.Mid(offset), ETrue);
+        }
+
+        if (used == 0)
+        {
+            break;
+        }
+        offset += used;
+
+        if (BudgetSpent())
+        {
+            break; /* Resumed from the next pump. */
+        }
+    }
+
+    return offset;
+}
+
+TInt CGameBTComms::DecodeRun(const TDesC8 &aData, TBool aInterruptible)
+{
+    const TUint8 *data   = aData.Ptr();
+    TInt          length = aData.Length();
+    TInt          offset = 0;
+
+    /* Frames are delimited by their length field.  In protocol 1 the
+     * trailing new line only serves as a check: if it is missing, the
+     * stream is out of sync and the decoder retries one byte later.
+     * The version can change between two frames, so it is looked at
+     * for every frame. */
+    while (offset < length)
+    {
+        TUint8 header  = data[offset];
+        TUint8 sender  = header & KRecipientMask;
+        TInt   trailer = (iRecvVersion == 1) ? 1 : 0;
+        TInt   headerSize;
+        TInt   payload;
+
+        if (iRecvVersion > 1)
+        {
+            header &= ~KChannelPresent;
+        }
+
+        if (sender > EToAll)
+        {
+            offset += 1;
+            continue;
+        }
+
+        if (! ParseHeader(&data[offset], length - offset, headerSize, payload))
+        {
+            break; /* Partial header, wait for the rest. */
+        }
+
+        if (payload > KMaxPayloadLength)
+        {
+            Log("Error: receive stream out of sync.\n");
+            offset += 1;
+            continue;
+        }
+
+        if (length - offset < headerSize + payload + trailer)
+        {
+            break; /* Partial frame, wait for the rest. */
+        }
+
+        if (trailer && (data[offset + headerSize + payload] != '\n'))
+        {
+            Log("Error: receive stream out of sync.\n");
+            offset += 1;
+            continue;
+        }
+
+        if (sender != 0x00)
+        {
+            if ((iRecvVersion > 1) && Stamped(header))
+            {
+                iFrameStamp = data[offset + headerSize - 2] | (data[offset + headerSize - 1] << 8);
+                if (iFrameStamp == KUnsyncedStamp)
+                {
+                    iFrameStamp = KErrNotFound;
+                }
+            }
+            ReceiveFrame(header, TPtrC8(&data[offset + headerSize], payload));
+            iFrameStamp = KErrNotFound;
+        }
+        else if ((iRecvVersion > 1) && (payload >= 13) && (data[offset + headerSize] == KClockMarker))
+        {
+            ClockAnswer(&data[offset + headerSize + 1]);
+        }
+        else if ((iGameCommsState == ERegisterAck) && (payload >= 2) && (data[offset + headerSize] == KRegisterMarker))
+        {
+            /* The hub accepted the registration frame, a protocol 2
+             * answer may follow right behind. */
+            RegistrationComplete();
+        }
+        else if ((iRecvVersion == 1) && (payload >= 2) &&
+                 (data[offset + headerSize] == KUpgradeMarker) && (data[offset + headerSize + 1] == KProtocolVersion))
+        {
+            /* The hub accepted the offer: everything it sends from here
+             * on is protocol 2, and so is everything not yet written.
+             * A third byte holds the capabilities it accepted. */
+            iRecvVersion = KProtocolVersion;
+            iSendVersion = KProtocolVersion;
+            iSendSwitch  = ETrue;
+            if (payload >= 3)
+            {
+                iCapabilities = data[offset + headerSize + 2] & OfferedCapabilities();
+            }
+            if (iCapabilities & KCapCrc)
+            {
+                /* The rest comes in checked batches. */
+                offset += headerSize + payload + trailer;
+                break;
+            }
+        }
+
+        offset += headerSize + payload + trailer;
+
+        if (iBudgeted)
+        {
+            iFramesLeft -= 1;
+        }
+
+        if (aInterruptible && BudgetSpent())
+        {
+            break; /* Resumed from the next pump. */
+        }
+    }
+
+    return offset;
+}
+
+TInt CGameBTComms::DecodeBatch(const TDesC8 &aData)
+{
+    const TUint8 *data   = aData.Ptr();
+    TInt          length = aData.Length();
+    TInt          span   = 0;
+    TInt          headerSize;
+    TInt          payload;
+    TUint16       crc;
+
+    /* Nothing of a batch is delivered before its trailer has been
+     * checked.  Anything that cannot be the start of a batch is
+     * skipped a byte at a time until the frames line up again. */
+    for (;;)
+    {
+        if (! ParseHeader(&data[span], length - span, headerSize, payload))
+        {
+            if (span + KMaxHeaderSize + KCrcTrailerSize <= KRecvBufferSize)
+            {
+                return 0; /* Partial header, wait for the rest. */
+            }
+
+            /* The rest would not fit into iRecvBuffer, so waiting would
+             * never end: the batch cannot be valid. */
+            Log("Error: receive stream out of sync.\n");
+            iCorruptBatches += 1;
+            return 1;
+        }
+
+        if ((payload > KMaxPayloadLength) ||
+            (span + headerSize + payload + KCrcTrailerSize > KRecvBufferSize))
+        {
+            Log("Error: receive stream out of sync.\n");
+            iCorruptBatches += 1;
+            return 1;
+        }
+
+        if (length - span < headerSize + payload)
+        {
+            return 0; /* Partial frame, wait for the rest. */
+        }
+
+        if ((data[span] & KRecipientMask) == KCrcTrailer)
+        {
+            break;
+        }
+
+        span += headerSize + payload;
+    }
+
+    if (payload != 2)
+    {
+        return 1;
+    }
+
+    crc = (TUint16)(data[span + headerSize] | (data[span + headerSize + 1] << 8));
+    if (TGameBTCommsCrc::Crc16(data, span) == crc)
+    {
+        DecodeRun(TPtrC8(data, span), EFalse);
+    }
+    else
+    {
+        Log("Error: batch of %d bytes failed the CRC check.\n", span);
+        iCorruptBatches += 1;
+
+        /* The batch may have held a keyframe, a delta or a fragment, so
+         * nothing that builds on earlier messages can be trusted.  Deltas
+         * are dropped until the next keyframe of their slot. */
+        iDeltaRecv->Reset();
+        for (TInt sender = 1; sender <= KMaxPlayers; sender += 1)
+        {
+            EndReassembly(sender);
+        }
+    }
+
+    return span + headerSize + payload;
+}
+
+TBool CGameBTComms::ParseHeader(const TUint8 *aData, TInt aLength, TInt &aHeaderSize, TInt &aPayload) const
+{
+    if (iRecvVersion == 1)
+    {
+        if (aLength < KFrameHeaderSize)
+        {
+            return EFalse;
+        }
+        aHeaderSize = KFrameHeaderSize;
+        aPayload    = aData[1];
+        return ETrue;
+    }
+
+    /* Protocol 2: header, length as a 7 bit varint, optional channel. */
+    aHeaderSize = 1;
+    aPayload    = 0;
+    for (TInt shift = 0; ; shift += 7)
+    {
+        if (aHeaderSize >= aLength)
+        {
+            return EFalse;
+        }
+
+        aPayload    |= (aData[aHeaderSize] & 0x7f) << shift;
+        aHeaderSize += 1;
+
+        if ((aData[aHeaderSize - 1] & 0x80) == 0)
+        {
+            break;
+        }
+        if (shift > 0)
+        {
+            aPayload = KMaxPayloadLength + 1; /* Longer than any frame, resynchronise. */
+            break;
+        }
+    }
+
+    if (aData[0] & KChannelPresent)
+    {
+        aHeaderSize += 1;
+    }
+    if (Stamped(aData[0]))
+    {
+        aHeaderSize += KStampSize;
+    }
+
+    return (aHeaderSize <= aLength) || (aPayload > KMaxPayloadLength);
+}
+
+TBool CGameBTComms::BudgetSpent() const
+{
+    TTime now;
+
+    if (! iBudgeted)
+    {
+        return EFalse;
+    }
+
+    if (iFramesLeft <= 0)
+    {
+        return ETrue;
+    }
+
+    now.HomeTime();
+
+    return (now >= iDeadline);
+}
+
+TInt CGameBTComms::ReceiveBacklog() const
+{
+    TInt backlog = iClient->BufferedLength();
+    TInt headerSize;
+    TInt payload;
+
+    /* A partial frame is not work that another pump could do. */
+    if (ParseHeader(iRecvBuffer.Ptr(), iRecvBuffer.Length(), headerSize, payload) &&
+        (iRecvBuffer.Length() >= headerSize + payload + ((iRecvVersion == 1) ? 1 : 0)))
+    {
+        backlog += iRecvBuffer.Length();
+    }
+
+    return backlog;
+}
+
+TInt CGameBTComms::SendBacklog() const
+{
+    /* Frames held back by the flush policy or waiting for a transmit
+     * slot are not work that another pump could do, and frames already
+     * written only wait for the link to complete. */
+    if ((! iFlushDue) && (iSendQueue->Used() - iSendInFlight < iFlushPolicy.iByteThreshold))
+    {
+        return 0;
+    }
+
+    if ((! iClient->IsReadyToSendMessage()) || (iWireCount == CMessageClient::KTransmitSlots))
+    {
+        return 0;
+    }
+
+    return iSendQueue->Used() - iSendInFlight;
+}
+
+TInt CGameBTComms::MissingBytes() const
+{
+    TInt missing = 1;
+    TInt headerSize;
+    TInt payload;
+
+    if (ParseHeader(iRecvBuffer.Ptr(), iRecvBuffer.Length(), headerSize, payload))
+    {
+        missing = headerSize + payload + ((iRecvVersion == 1) ? 1 : 0) - iRecvBuffer.Length();
+    }
+    else if (iRecvVersion == 1)
+    {
+        missing = KFrameOverhead - iRecvBuffer.Length();
+    }
+
+    return Max(1, missing);
+}
+
+void CGameBTComms::Update()
+{
+    char  *buffer  = iLine;
+    TBool  canSend = iClient->IsReadyToSendMessage();
+
+    /* Only the states that send need a free transmit slot, received
+     * data is decoded even while both slots are busy. */
+    if ((canSend == EFalse) && (iGameCommsState != ERegisterAck) && (iGameCommsState != EHandleMessages))
+    {
+        return;
+    }
+
+    switch (iGameCommsState)
+    {
+        case EInit:
+        {
+            if (iConnectionRoleTemp != EIdle)
+            {
+                SendRegistrationL();
+                iRegisterSent.HomeTime();
+                iGameCommsState = ERegisterAck;
+            }
+            break;
+        }
+        case ERegisterAck:
+        {
+            TTime now;
+
+            /* The hub's answer completes the registration from within
+             * the decoder. */
+            ReceivePendingL();
+
+            now.HomeTime();
+            if ((iGameCommsState == ERegisterAck) && (now.MicroSecondsFrom(iRegisterSent).Int64() >= TInt64(KRegisterTimeout)))
+            {
+                Log("No answer to the registration frame, falling back to text.\n");
+                iGameCommsState = ERegisterUID;
+            }
+            break;
+        }
+        case ERegisterUID:
+        {
+            sprintf(buffer, (const char *)"UID:0x%08X\n", (unsigned int)iGameUID);
+            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+            iGameCommsState = ERegisterDeviceName;
+            break;
+        }
+        case ERegisterDeviceName:
+        {
+            sprintf(buffer, (const char *)"DID:%s\n", iDeviceName);
+
+            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+            iGameCommsState = ERegisterNetConfig;
+            break;
+        }
+        case ERegisterNetConfig:
+        {
+            sprintf(buffer, (const char *)"NET:%s:%u\n", iHost, (unsigned short)iPort);
+
+            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+            iGameCommsState = ERegisterProtocol;
+            break;
+        }
+        case ERegisterProtocol:
+        {
+            /* A hub that knows protocol 2 answers the offer after ROL,
+             * older hubs ignore the line and the link stays at 1. */
+            if (OfferedCapabilities())
+            {
+                sprintf(buffer, (const char *)"PRO:%d:%02X\n", (int)KProtocolVersion, (unsigned int)OfferedCapabilities());
+            }
+            else
+            {
+                sprintf(buffer, (const char *)"PRO:%d\n", (int)KProtocolVersion);
+            }
+
+            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+            iGameCommsState = ERegisterRole;
+            break;
+        }
+        case ERegisterRole:
+        {
+            char role;
+
+            if (iConnectionRoleTemp == EHost)
+            {
+                role = 'H';
+            }
+            else
+            {
+                role = 'C';
+            }
+
+            sprintf(buffer, (const char *)"ROL:%c\n", role);
+
+            iClient->SendMessageL(TPtrC8((const TText8 *)buffer));
+            RegistrationComplete();
+            break;
+        }
+        case EHandleMessages:
+            iConnectionRole = iConnectionRoleTemp; /* Asign selected connection role */
+
+            if (canSend)
+            {
+                if (iCapabilities & KCapClock)
+                {
+                    SyncClockL();
+                }
+
+                SendPendingL();
+            }
+
+            ReceivePendingL();
+            break;
+    }
+}
+
+void CGameBTComms::SendRegistrationL()
+{
+    TUint8 *frame  = (TUint8 *)iLine;
+    TInt    length = 0;
+    TInt    name   = strlen(iDeviceName);
+    TInt    host   = strlen(iHost);
+
+    /* All registration fields in one void frame, see README.md.  Older
+     * hubs read it as text lines they do not know. */
+    frame[length++] = 0x00;
+    frame[length++] = 0x00; /* Payload length, set below */
+    frame[length++] = KRegisterMarker;
+    frame[length++] = KRegisterFormat;
+    frame[length++] = (TUint8)(iGameUID & 0xff);
+    frame[length++] = (TUint8)((iGameUID >> 8) & 0xff);
+    frame[length++] = (TUint8)((iGameUID >> 16) & 0xff);
+    frame[length++] = (TUint8)((iGameUID >> 24) & 0xff);
+    frame[length++] = (iConnectionRoleTemp == EHost) ? 'H' : 'C';
+    frame[length++] = KProtocolVersion;
+    frame[length++] = OfferedCapabilities();
+    frame[length++] = (TUint8)(iPort & 0xff);
+    frame[length++] = (TUint8)((iPort >> 8) & 0xff);
+    frame[length++] = (TUint8)name;
+    memcpy(&frame[length], iDeviceName, name);
+    length += name;
+    frame[length++] = (TUint8)host;
+    memcpy(&frame[length], iHost, host);
+    length += host;
+
+    frame[1]        = (TUint8)(length - KFrameHeaderSize);
+    frame[length++] = '\n';
+
+    iClient->SendMessageL(TPtrC8(frame, length));
+}
+
+void CGameBTComms::RegistrationComplete()
+{
+    /* Set before the callback and before the rest of the read is
+     * decoded: both may already depend on the role. */
+    iConnectionRole = iConnectionRoleTemp;
+    iGameState      = EPlay;
+    iGameCommsState = EHandleMessages;
+
+    iNotify->StartMultiPlayerGame(KErrNone);
+}
+
+TInt CGameBTComms::OfferedCapabilities() const
+{
+    return (iCompressor ? KCapCompress : 0) | (iCrc ? KCapCrc : 0) | (iClock ? KCapClock : 0);
+}
+
+void CGameBTComms::SyncClockL()
+{
+    TUint8 *frame  = (TUint8 *)iLine;
+    TInt    length;
+    TInt    batch;
+    TTime   now;
+    TUint32 local;
+
+    now.HomeTime();
+    if (now.MicroSecondsFrom(iClockSent).Int64() < TInt64(iClockInterval))
+    {
+        return;
+    }
+    local = now.Int64().Low();
+
+    /* A void frame of its own, the hub answers with its receive and
+     * transmit time, see README.md.  Being a write of its own it also
+     * forms a batch of its own. */
+    length = SwitchVersion(frame);
+    batch  = length;
+    frame[length++] = 0x00;
+    frame[length++] = 5;
+    frame[length++] = KClockMarker;
+    frame[length++] = (TUint8)(local & 0xff);
+    frame[length++] = (TUint8)((local >> 8) & 0xff);
+    frame[length++] = (TUint8)((local >> 16) & 0xff);
+    frame[length++] = (TUint8)((local >> 24) & 0xff);
+    if (iCapabilities & KCapCrc)
+    {
+        length += AppendTrailer(&frame[batch], length - batch);
+    }
+
+    iClient->SendMessageL(TPtrC8(frame, length));
+    iClockSent  = now;
+    iSendSwitch = EFalse;
+}
+
+void CGameBTComms::ClockAnswer(const TUint8 *aData)
+{
+    TTime   now;
+    TUint32 sent;
+    TUint32 received;
+    TUint32 answered;
+    TInt    delay;
+    TInt    best = 0;
+
+    now.HomeTime();
+    sent     = aData[0] | (aData[1] << 8) | (aData[2] << 16) | (aData[3] << 24);
+    received = aData[4] | (aData[5] << 8) | (aData[6] << 16) | (aData[7] << 24);
+    answered = aData[8] | (aData[9] << 8) | (aData[10] << 16) | (aData[11] << 24);
+
+    /* Round trip time without the time the hub held the request.  Both
+     * clocks wrap at 2^32 us, differences of each clock stay valid. */
+    delay = (TInt)(now.Int64().Low() - sent) - (TInt)(answered - received);
+    if (delay < 0)
+    {
+        delay = 0; /* The local clock ticks coarser than the hub's. */
+    }
+
+    iSampleOffset[iSampleNext] = (received - sent) - (TUint32)(delay / 2);
+    iSampleDelay[iSampleNext]  = delay;
+    iSampleNext                = (iSampleNext + 1) % KClockSamples;
+    if (iSampleCount < KClockSamples)
+    {
+        iSampleCount += 1;
+    }
+
+    /* Queueing only ever adds delay, so the fastest exchange is the
+     * most symmetric one. */
+    for (TInt sample = 1; sample < iSampleCount; sample += 1)
+    {
+        if (iSampleDelay[sample] < iSampleDelay[best])
+        {
+            best = sample;
+        }
+    }
+
+    iClockOffset = iSampleOffset[best];
+    iLatency     = iSampleDelay[best] / 2;
+}
+
+TUint16 CGameBTComms::Stamp() const
+{
+    TTime   now;
+    TUint16 stamp;
+
+    /* Without an offset the local clock would pass for the hub's. */
+    if (iSampleCount == 0)
+    {
+        return KUnsyncedStamp;
+    }
+
+    now.HomeTime();
+    stamp = (TUint16)(((TUint32)now.Int64().Low() + iClockOffset) >> KStampShift);
+
+    /* Keep the reserved value unambiguous, one unit is well below a tick. */
+    return (stamp == KUnsyncedStamp) ? (TUint16)(KUnsyncedStamp - 1) : stamp;
+}
+
+TBool CGameBTComms::Stamped(TUint8 aHeader) const
+{
+    TUint8 recipient = aHeader & KRecipientMask;
+
+    /* Everything but void frames, blocks and trailers. */
+    return (iCapabilities & KCapClock) && (recipient != 0x00) &&
+           (recipient != KCompressedBlock) && (recipient != KCrcTrailer);
+}
+
+void CGameBTComms::SendQueued()
+{
+    if (iGameCommsState != EHandleMessages)
+    {
+        return; /* The pump sends once registration is complete. */
+    }
+
+    /* Only the flush policy is evaluated here, everything else is left
+     * to the pump. */
+    TRAPD(error, SendPendingL());
+    if (error != KErrNone)
+    {
+        Log("Error: send failed (%d).\n", error);
+    }
+}
+
+void CGameBTComms::SendPendingL()
+{
+    TPtrC8  pending;
+    TTime   now;
+    TUint32 latency;
+    TInt    frames = 0;
+
+    if (iSendQueue->Used() == iSendInFlight)
+    {
+        /* Nothing left that has not been handed to the socket. */
+        iPending  = EFalse;
+        iFlushDue = EFalse;
+        iFlushTimer->Cancel();
+        return;
+    }
+
+    if ((! iFlushDue) && (iSendQueue->Used() - iSendInFlight < iFlushPolicy.iByteThreshold))
+    {
+        return;
+    }
+
+    if ((! iClient->IsReadyToSendMessage()) || (iWireCount == CMessageClient::KTransmitSlots))
+    {
+        /* Both transmit slots are busy, WriteComplete() comes back here. */
+        return;
+    }
+
+    pending = iSendQueue->Readable(iSendInFlight);
+    for (TInt offset = 0; offset < pending.Length(); offset += KFrameOverhead + pending[offset + 1])
+    {
+        if (iBudgeted && (frames > 0) && (frames >= iFramesLeft))
+        {
+            /* Pump(TInt) ran out of budget, the rest goes out with
+             * the next pump. */
+            pending.Set(pending.Left(offset));
+            break;
+        }
+        frames += 1;
+    }
+
+    if (iBudgeted)
+    {
+        iFramesLeft -= frames;
+    }
+
+    if (iSendVersion == 1)
+    {
+        /* Hand the oldest contiguous run of unsent frames to the socket as is. */
+        iClient->WriteL(pending);
+    }
+    else
+    {
+        /* The arena keeps the protocol 1 layout, the run is transcoded
+         * into the next free wire buffer. */
+        TInt    slot = (iWireHead + iWireCount) % CMessageClient::KTransmitSlots;
+        TUint8 *wire;
+
+        if (! iWire[slot])
+        {
+            /* Allocated on the first write after the upgrade, protocol 1
+             * links never need it.  A leave keeps the frames queued. */
+            iWire[slot] = (TUint8 *)User::AllocL(KWireBufferSize);
+        }
+        wire = iWire[slot];
+
+        iClient->WriteL(TPtrC8(wire, EncodeFrames(pending, wire)));
+        iWireSource[slot].Set(pending);
+        iWireCount  += 1;
+        iSendSwitch  = EFalse;
+    }
+    iSendInFlight += pending.Length();
+
+    /* Frames handed to the socket can no longer be replaced. */
+    for (TInt recipient = 0; recipient < EToAll; recipient += 1)
+    {
+        for (TInt channel = 0; channel < KMaxLatestChannels; channel += 1)
+        {
+            TUint8 *frame = iLatestFrame[recipient][channel];
+
+            if ((frame >= pending.Ptr()) && (frame < pending.Ptr() + pending.Length()))
+            {
+                iLatestFrame[recipient][channel] = NULL;
+            }
+        }
+    }
+
+    now.HomeTime();
+    latency = (TUint32)now.MicroSecondsFrom(iPendingSince).Int64().Low();
+
+    iFlushStats.iFlushes      += 1;
+    iFlushStats.iFrames       += frames;
+    iFlushStats.iLastLatency   = latency;
+    iFlushStats.iTotalLatency += latency;
+    if ((TUint32)frames > iFlushStats.iMaxFrames)
+    {
+        iFlushStats.iMaxFrames = frames;
+    }
+    if (latency > iFlushStats.iMaxLatency)
+    {
+        iFlushStats.iMaxLatency = latency;
+    }
+
+    if (iSendQueue->Used() > iSendInFlight)
+    {
+        /* Frames behind the wrap point go out with the next transmit slot. */
+        iPendingSince = now;
+        StartFlushTimer();
+    }
+    else
+    {
+        iPending  = EFalse;
+        iFlushDue = EFalse;
+        iFlushTimer->Cancel();
+    }
+}
+
+TInt CGameBTComms::EncodeFrames(const TDesC8 &aFrames, TUint8 *aWire)
+{
+    TInt length = SwitchVersion(aWire);
+    TInt block  = 0;
+    TInt batch  = length;
+
+    /* All frames of a write leave at about the same time. */
+    if (iCapabilities & KCapClock)
+    {
+        iSendStamp = Stamp();
+    }
+
+    for (TInt offset = 0; offset < aFrames.Length(); offset += KFrameOverhead + aFrames[offset + 1])
+    {
+        const TUint8 *frame = aFrames.Ptr() + offset;
+
+        if (! (iCapabilities & KCapCompress))
+        {
+            length += TranscodeFrame(frame, &aWire[length]);
+        }
+        else if (block + KMaxHeaderSize + frame[1] > KCompressBlock)
+        {
+            /* Blocks hold whole frames, so the hub can parse each one
+             * on its own. */
+            length += PackBlock(block, &aWire[length]);
+            block   = TranscodeFrame(frame, iBlock);
+        }
+        else
+        {
+            block += TranscodeFrame(frame, &iBlock[block]);
+            continue;
+        }
+
+        if ((iCapabilities & KCapCrc) && (length - batch >= KCrcSpan))
+        {
+            length += AppendTrailer(&aWire[batch], length - batch);
+            batch   = length;
+        }
+    }
+
+    if (block > 0)
+    {
+        length += PackBlock(block, &aWire[length]);
+    }
+
+    /* Every write ends a batch, so batches never span two writes. */
+    if ((iCapabilities & KCapCrc) && (length > batch))
+    {
+        length += AppendTrailer(&aWire[batch], length - batch);
+    }
+
+    return length;
+}
+
+TInt CGameBTComms::SwitchVersion(TUint8 *aWire)
+{
+    if (! iSendSwitch)
+    {
+        return 0;
+    }
+
+    /* Tells the hub where protocol 2 starts, a void frame in 1.  The
+     * caller clears iSendSwitch once the write has been accepted. */
+    aWire[0] = 0x00;
+    aWire[1] = 2;
+    aWire[2] = KUpgradeMarker;
+    aWire[3] = KProtocolVersion;
+    aWire[4] = '\n';
+
+    return KUpgradeSize;
+}
+
+TInt CGameBTComms::AppendTrailer(TUint8 *aBatch, TInt aLength)
+{
+    TUint16 crc = TGameBTCommsCrc::Crc16(aBatch, aLength);
+
+    aBatch[aLength]     = KCrcTrailer;
+    aBatch[aLength + 1] = 2;
+    aBatch[aLength + 2] = (TUint8)(crc & 0xff);
+    aBatch[aLength + 3] = (TUint8)(crc >> 8);
+
+    return KCrcTrailerSize;
+}
+
+TInt CGameBTComms::TranscodeFrame(const TUint8 *aFrame, TUint8 *aWire)
+{
+    TInt payload = aFrame[1];
+    TInt channel = LatestChannel(aFrame);
+    TInt length  = 0;
+
+    if (aFrame[0] == 0x00)
+    {
+        /* Voided frames shrink to their header. */
+        aWire[length++] = 0x00;
+        aWire[length++] = 0x00;
+        return length;
+    }
+
+    aWire[length++] = aFrame[0] | ((channel >= 0) ? KChannelPresent : 0);
+    if (payload > 0x7f)
+    {
+        aWire[length++] = (payload & 0x7f) | 0x80;
+        aWire[length++] = payload >> 7;
+    }
+    else
+    {
+        aWire[length++] = payload;
+    }
+    if (channel >= 0)
+    {
+        aWire[length++] = channel;
+    }
+    if (Stamped(aFrame[0]))
+    {
+        aWire[length++] = (TUint8)(iSendStamp & 0xff);
+        aWire[length++] = (TUint8)(iSendStamp >> 8);
+    }
+
+    memcpy(&aWire[length], &aFrame[KFrameHeaderSize], payload);
+    length += payload;
+
+    return length;
+}
+
+TInt CGameBTComms::PackBlock(TInt aLength, TUint8 *aWire)
+{
+    /* The length is always written as 2 varint bytes, so the data can
+     * be compressed to its final place.  Only a smaller result is kept. */
+#if GAMECOMMS_EXTRAS
+    TInt packed = iCompressor->Compress(iBlock, aLength, &aWire[3], aLength - 4);
+#else
+    TInt packed = 0; /* Not reached, there is no compressor */
+#endif
+
+    iFlushStats.iBlockBytes += aLength;
+
+    if (packed == 0)
+    {
+        Mem::Copy(aWire, iBlock, aLength);
+        iFlushStats.iPackedBytes += aLength;
+        return aLength;
+    }
+
+    aWire[0] = KCompressedBlock;
+    aWire[1] = (TUint8)((packed & 0x7f) | 0x80);
+    aWire[2] = (TUint8)(packed >> 7);
+    iFlushStats.iPackedBytes += 3 + packed;
+
+    return 3 + packed;
+}
+
+/* fopen() allocates, so static memory mode does not log. */
+void CGameBTComms::Log(const char *aFormat, ...)
+{
+    va_list varg;
+
+    if (iStaticMemory)
+    {
+        return;
+    }
+
+    va_start(varg, aFormat);
+    DebugLogV(LOG, aFormat, varg);
+    va_end(varg);
+}
+
+TInt CGameBTComms::LatestChannel(const TUint8 *aFrame) const
+{
+    for (TInt recipient = 0; recipient < EToAll; recipient += 1)
+    {
+        for (TInt channel = 0; channel < KMaxLatestChannels; channel += 1)
+        {
+            if (iLatestFrame[recipient][channel] == aFrame)
+            {
+                return channel;
+            }
+        }
+    }
+
+    return -1;
+}
+
+void CGameBTComms::WriteComplete(const TDesC8 &aData, TInt aError)
+{
+    TPtrC8 frames(aData);
+
+    /* A transcoded write stands for the arena span it was made from. */
+    if ((iWireCount > 0) && (aData.Ptr() == iWire[iWireHead]))
+    {
+        frames.Set(iWireSource[iWireHead]);
+        iWireHead   = (iWireHead + 1) % CMessageClient::KTransmitSlots;
+        iWireCount -= 1;
+    }
+
+    /* Writes complete in order, so frames is always the oldest span. */
+    ReleaseFrames(frames);
+    iSendQueue->Consume(frames.Length());
+    iSendInFlight -= frames.Length();
+
+    if ((aError == KErrNone) && (iGameCommsState == EHandleMessages))
+    {
+        /* Keep the link busy: queue the next batch right away. */
+        TRAPD(error, SendPendingL());
+        if (error != KErrNone)
+        {
+            Log("Error: send failed (%d).\n", error);
+        }
+    }
+}
+
+TInt CGameBTComms::ReadComplete(const TDesC8 &aData)
+{
+    TInt offset = 0;
+
+    if ((iReceiveMode != EReceiveEvent) || (iGameCommsState < ERegisterAck) || iDecoding)
+    {
+        return 0; /* Stored by iClient until the next poll. */
+    }
+
+    iDecoding = ETrue;
+
+    /* Older data still waiting in iClient goes first. */
+    TRAPD(error, DrainClientL());
+    if (error != KErrNone)
+    {
+        Log("Error: receive failed (%d).\n", error);
+    }
+
+    /* Complete the partial frame left over from the previous read. */
+    while ((iRecvBuffer.Length() > 0) && (offset < aData.Length()))
+    {
+        TInt take = Min(MissingBytes(), aData.Length() - offset);
+
+        iRecvBuffer.Append(aData.Mid(offset, take));
+        offset += take;
+        iRecvBuffer.Delete(0, DecodeFrames(iRecvBuffer));
+    }
+
+    /* Decode the rest in place, without a batch notify the game is
+     * handed pointers into the read buffer.  Only a trailing partial
+     * frame is copied. */
+    if (offset < aData.Length())
+    {
+        offset += DecodeFrames(aData.Mid(offset));
+        iRecvBuffer.Append(aData.Mid(offset));
+        offset = aData.Length();
+    }
+
+    FlushBatch();
+    iDecoding = EFalse;
+
+    return offset;
+}
+
+void CGameBTComms::ReleaseFrames(const TDesC8 &aFrames)
+{
+    for (TInt offset = 0; offset < aFrames.Length(); offset += KFrameOverhead + aFrames[offset + 1])
+    {
+        TUint8 target = aFrames[offset] & KRecipientMask;
+
+        for (TUint8 recipient = EToHost; recipient <= EToAll; recipient += 1)
+        {
+            if (((target & KRecipientMulticast) && Reaches(target, recipient)) || (target == recipient))
+            {
+                iQueueStatus[recipient - 1].iQueuedBytes  -= KFrameOverhead + aFrames[offset + 1];
+                iQueueStatus[recipient - 1].iQueuedFrames -= 1;
+            }
+        }
+    }
+}
+
+void CGameBTComms::StartFlushTimer()
+{
+    iFlushTimer->Cancel();
+    iFlushTimer->Start(iFlushPolicy.iMaxDelay, iFlushPolicy.iMaxDelay, TCallBack(FlushTimerCallBack, this));
+}
+
+void CGameBTComms::StartPumpTimer()
+{
+    iPumpTimer->Cancel();
+
+    if (iPumpInterval > 0)
+    {
+        iPumpTimer->Start(iPumpInterval, iPumpInterval, TCallBack(PumpTimerCallBack, this));
+    }
+}
+
+TInt CGameBTComms::PumpTimerCallBack(TAny *aSelf)
+{
+    CGameBTComms *self = (CGameBTComms *)aSelf;
+
+    TRAPD(error, self->Update());
+    if (error != KErrNone)
+    {
+        self->Log("Error: pump failed (%d).\n", error);
+    }
+
+    return 0;
+}
+
+TInt CGameBTComms::FlushTimerCallBack(TAny *aSelf)
+{
+    CGameBTComms *self = (CGameBTComms *)aSelf;
+
+    self->iFlushDue = ETrue;
+
+    TRAPD(error, self->Update());
+    if (error != KErrNone)
+    {
+        self->Log("Error: flush failed (%d).\n", error);
+    }
+
+    return 0;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::GetQueueStatus(TUint16 aRecipient, TQueueStatus &aStatus)
+{
+    if ((aRecipient < EToHost) || (aRecipient > EToAll))
+    {
+        return KErrArgument;
+    }
+
+    aStatus            = iQueueStatus[aRecipient - 1];
+    aStatus.iFreeBytes = iSendQueue->Size() - iSendQueue->Used();
+
+    return KErrNone;
+}
+
+GAMECOMMS_EXPORT_C void CGameBTComms::SetFlushPolicy(const TFlushPolicy &aPolicy)
+{
+    iFlushPolicy = aPolicy;
+
+    if (iFlushPolicy.iMaxDelay < KMinFlushDelay)
+    {
+        iFlushPolicy.iMaxDelay = KMinFlushDelay;
+    }
+
+    if (iPending)
+    {
+        StartFlushTimer();
+    }
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::Flush()
+{
+    iFlushDue = ETrue;
+
+    TRAPD(error, Update());
+    if (error != KErrNone)
+    {
+        Log("Error: flush failed (%d).\n", error);
+    }
+
+    return error;
+}
+
+GAMECOMMS_EXPORT_C void CGameBTComms::GetFlushStats(TFlushStats &aStats)
+{
+    aStats = iFlushStats;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::SetReceiveMode(TReceiveMode aMode)
+{
+    TInt error = KErrNone;
+
+    iReceiveMode = aMode;
+
+    if ((iReceiveMode == EReceiveEvent) && (iGameCommsState == EHandleMessages))
+    {
+        /* Deliver what has arrived in the meantime. */
+        TRAP(error, ReceivePendingL());
+        if (error != KErrNone)
+        {
+            Log("Error: receive failed (%d).\n", error);
+        }
+    }
+
+    return error;
+}
+
+GAMECOMMS_EXPORT_C void CGameBTComms::SetBatchNotify(MGameBTCommsBatchNotify *aBatchNotify)
+{
+    /* Hand the messages collected so far to the old receiver. */
+    FlushBatch();
+
+    iBatchNotify = aBatchNotify;
+}
+
+GAMECOMMS_EXPORT_C void CGameBTComms::SetPumpInterval(TInt aInterval)
+{
+    if ((aInterval > 0) && (aInterval < KMinPumpInterval))
+    {
+        aInterval = KMinPumpInterval;
+    }
+
+    iPumpInterval = aInterval;
+    StartPumpTimer();
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::Pump()
+{
+    TRAPD(error, Update());
+    if (error != KErrNone)
+    {
+        Log("Error: pump failed (%d).\n", error);
+    }
+
+    return error;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::Pump(TInt aBudget)
+{
+    /* HomeTime() is too coarse for budgets of a few ms, the frame
+     * count bounds the work in between its ticks. */
+    iDeadline.HomeTime();
+    iDeadline   += TTimeIntervalMicroSeconds32(aBudget);
+    iFramesLeft  = Max(1, aBudget / KFrameCost);
+    iBudgeted    = ETrue;
+
+    TRAPD(error, Update());
+    if (error != KErrNone)
+    {
+        Log("Error: pump failed (%d).\n", error);
+    }
+
+    iBudgeted = EFalse;
+
+    if (error != KErrNone)
+    {
+        return error;
+    }
+
+    return ReceiveBacklog() + SendBacklog();
+}
+
+GAMECOMMS_EXPORT_C void CGameBTComms::GetIoStats(CMessageClient::TIoStats &aStats)
+{
+    aStats = iClient->IoStats();
+    aStats.iCorruptBatches = iCorruptBatches;
+    aStats.iBadFragments   = iBadFragments;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::GetLatency(TInt &aOneWay)
+{
+    if (iLatency < 0)
+    {
+        return KErrNotReady;
+    }
+
+    aOneWay = iLatency;
+    return KErrNone;
+}
+
+GAMECOMMS_EXPORT_C TInt CGameBTComms::GetFrameAge(TInt &aAge)
+{
+    if (iSampleCount == 0)
+    {
+        return KErrNotReady;
+    }
+
+    if (iFrameStamp < 0)
+    {
+        return KErrNotFound;
+    }
+
+    /* Stamps wrap after 67 s, older messages are not expected. */
+    aAge = ((Stamp() - iFrameStamp) & 0xffff) << KStampShift;
+    return KErrNone;
+}
+
+void CGameBTComms::ConstructL(MGameBTCommsNotify *aEventHandler, TUint32 aGameUID, RSGEDebugLog *aLog)
+{
+    iNotify             = aEventHandler;
+    iGameUID            = aGameUID;
+    iLog                = aLog;
+    iConnectionRole     = EIdle;
+    iConnectionRoleTemp = EIdle;
+    iConnectState       = ENotConnected;
+    iGameState          = EGameOver;
+    iClient             = NULL;
+    iClientObject       = NULL;
+    iDecoding           = EFalse;
+    iBudgeted           = EFalse;
+    iFramesLeft         = 0;
+    iBatchNotify        = NULL;
+    iBatchCount         = 0;
+    iReceiveMode        = ini_getbool("Receive", "EventDriven", 0, IniFile) ? EReceiveEvent : EReceivePolled;
+    iSendQueue          = CGameBTCommsRing::NewL(KSendArenaSize);
+    iSendInFlight       = 0;
+    iSendVersion        = 1;
+    iRecvVersion        = 1;
+    iSendSwitch         = EFalse;
+    iWireHead           = 0;
+    iWireCount          = 0;
+    iDeltaSend          = NULL;
+    iCompressor         = NULL;
+    iCapabilities       = 0;
+    iCorruptBatches     = 0;
+    iBadFragments       = 0;
+    iClockSent          = TInt64(0);
+    iClockOffset        = 0;
+    iSendStamp          = 0;
+    iLatency            = -1;
+    iSampleCount        = 0;
+    iSampleNext         = 0;
+    iFrameStamp         = KErrNotFound;
+    iDeltaRecv          = CGameBTCommsDelta::NewL(KMaxPlayers * 2 * CGameBTCommsDelta::KMaxChannels, 0);
+    iFlushTimer         = CPeriodic::NewL(CActive::EPriorityStandard);
+    iPumpTimer          = CPeriodic::NewL(CActive::EPriorityStandard);
+    iPending            = EFalse;
+    iFlushDue           = EFalse;
+
+    memset(iDeviceName, 0, sizeof(iDeviceName));
+    memset(iHost, 0, sizeof(iHost));
+    memset(&iFlushStats, 0, sizeof(TFlushStats));
+    memset(iLatestFrame, 0, sizeof(iLatestFrame));
+    memset(iQueueStatus, 0, sizeof(iQueueStatus));
+    memset(iReassembly, 0, sizeof(iReassembly));
+    memset(iReassemblyPool, 0, sizeof(iReassemblyPool));
+    memset(iWire, 0, sizeof(iWire));
+
+    /* In static memory mode every buffer needed while playing is taken
+     * from here, so no heap operation happens after construction. */
+    iStaticMemory = ini_getbool("Memory", "Static", 0, IniFile);
+    if (iStaticMemory)
+    {
+        TInt block = ini_getl("Memory", "ReassemblySize", KReassemblySize, IniFile);
+
+        for (TInt index = 0; index < KMaxPlayers; index += 1)
+        {
+            iReassemblyPool[index] = HBufC8::NewL(block);
+        }
+
+        /* Otherwise allocated once the hub accepts protocol 2. */
+        for (TInt slot = 0; slot < CMessageClient::KTransmitSlots; slot += 1)
+        {
+            iWire[slot] = (TUint8 *)User::AllocL(KWireBufferSize);
+        }
+    }
+
+    if (ini_getbool("Delta", "Enabled", 0, IniFile))
+    {
+        TInt interval = ini_getl("Delta", "KeyInterval", KDefaultKeyInterval, IniFile);
+
+        iDeltaSend = CGameBTCommsDelta::NewL(EToAll * CGameBTCommsDelta::KMaxChannels, interval);
+    }
+
+    iCrc = ini_getbool("Crc", "Enabled", 0, IniFile);
+
+#if GAMECOMMS_EXTRAS
+    iClock         = ini_getbool("Clock", "Enabled", 0, IniFile);
+    iClockInterval = ini_getl("Clock", "Interval", KDefaultClockInterval / 1000, IniFile) * 1000;
+
+    if (ini_getbool("Compress", "Enabled", 0, IniFile))
+    {
+        iCompressor = CGameBTCommsLz::NewL();
+    }
+#else
+    iClock         = EFalse;
+    iClockInterval = KDefaultClockInterval;
+#endif
+
+    /* Everything the registration needs is read up front. */
+    iPort = ini_getl("Network", "Port", 8889, IniFile);
+    ini_gets("Network", "Host", "localhost", iHost, sizeof(iHost), IniFile);
+
+    TFlushPolicy policy;
+    TInt         interval;
+
+    policy.iByteThreshold = ini_getl("Flush", "Threshold", KDefaultFlushThreshold, IniFile);
+    policy.iMaxDelay      = ini_getl("Flush", "MaxDelay", KDefaultFlushDelay / 1000, IniFile) * 1000;
+    SetFlushPolicy(policy);
+
+    ini_gets("Config", "DeviceName", "bosley", iDeviceName, sizeof(iDeviceName), IniFile);
+    interval = ini_getl("Pump", "Interval", KDefaultPumpInterval / 1000, IniFile) * 1000;
+#if GAMECOMMS_EXTENDED_API == 0
+    if (interval <= 0)
+    {
+        /* Pump() is not exported, nothing else would make progress. */
+        interval = KDefaultPumpInterval;
+    }
+#endif
+    SetPumpInterval(interval);
+
+#if GAMECOMMS_EXTRAS
+    if (ini_getbool("Thread", "Enabled", 0, IniFile))
+    {
+        /* Socket I/O runs in a thread of its own, see CGameBTCommsThread. */
+        CGameBTCommsThread *thread = CGameBTCommsThread::NewL(this, KThreadRingSize, KWireBufferSize, KThreadInterval);
+
+        iClient       = thread;
+        iClientObject = thread;
+    }
+    else
+#endif
+    {
+        CMessageClient *client = CMessageClient::NewL(this);
+
+        iClient       = client;
+        iClientObject = client;
     }
 
     if (iClient)
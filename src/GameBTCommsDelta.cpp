@@ -0,0 +1,204 @@
+/** @file GameBTCommsDelta.cpp
+ *
+ *  Delta codec for payloads resent with few changes.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <e32def.h>
+#include <e32std.h>
+
+#include "GameBTCommsDelta.h"
+
+CGameBTCommsDelta *CGameBTCommsDelta::NewL(TInt aSlots, TInt aKeyInterval)
+{
+    CGameBTCommsDelta *self = new (ELeave) CGameBTCommsDelta;
+
+    CleanupStack::PushL(self);
+    self->ConstructL(aSlots, aKeyInterval);
+    CleanupStack::Pop();
+
+    return self;
+}
+
+CGameBTCommsDelta::CGameBTCommsDelta()
+{
+}
+
+CGameBTCommsDelta::~CGameBTCommsDelta()
+{
+    User::Free(iSinceKey);
+    User::Free(iLength);
+    User::Free(iReference);
+}
+
+void CGameBTCommsDelta::ConstructL(TInt aSlots, TInt aKeyInterval)
+{
+    iReference   = (TUint8 *)User::AllocL(aSlots * KMaxLength);
+    iLength      = (TInt *)User::AllocL(aSlots * sizeof(TInt));
+    iSinceKey    = (TInt *)User::AllocL(aSlots * sizeof(TInt));
+    iKeyInterval = aKeyInterval;
+    iSlots       = aSlots;
+
+    Mem::FillZ(iLength, aSlots * sizeof(TInt));
+    Mem::FillZ(iSinceKey, aSlots * sizeof(TInt));
+}
+
+TPtrC8 CGameBTCommsDelta::Encode(TInt aSlot, TUint8 aTag, const TDesC8 &aData)
+{
+    const TUint8 *reference = iReference + aSlot * KMaxLength;
+    const TUint8 *data      = aData.Ptr();
+    TInt          length    = aData.Length();
+    TInt          index     = 0;
+
+    if ((iLength[aSlot] != length) || ((iKeyInterval > 0) && (iSinceKey[aSlot] >= iKeyInterval)))
+    {
+        return Keyframe(aSlot, aTag, aData);
+    }
+
+    iCoded.Zero();
+    iCoded.Append(aTag);
+
+    while (index < length)
+    {
+        TInt run = 0;
+
+        while ((index + run < length) && (run < 0x80) && (data[index + run] == reference[index + run]))
+        {
+            run += 1;
+        }
+
+        if (run > 0)
+        {
+            if (iCoded.Length() + 1 > length)
+            {
+                return Keyframe(aSlot, aTag, aData);
+            }
+
+            iCoded.Append((TUint8)(0x80 | (run - 1)));
+            index += run;
+            continue;
+        }
+
+        /* A single unchanged byte is cheaper inside the literal than as
+         * a token of its own. */
+        while ((index + run < length) && (run < 0x80) &&
+               ((data[index + run] != reference[index + run]) ||
+                ((index + run + 1 < length) && (data[index + run + 1] != reference[index + run + 1]))))
+        {
+            run += 1;
+        }
+
+        if (iCoded.Length() + 1 + run > length)
+        {
+            return Keyframe(aSlot, aTag, aData);
+        }
+
+        iCoded.Append((TUint8)(run - 1));
+        for (TInt offset = 0; offset < run; offset += 1)
+        {
+            iCoded.Append(data[index + offset] ^ reference[index + offset]);
+        }
+        index += run;
+    }
+
+    Mem::Copy(iReference + aSlot * KMaxLength, data, length);
+    iSinceKey[aSlot] += 1;
+
+    return iCoded;
+}
+
+TPtrC8 CGameBTCommsDelta::Keyframe(TInt aSlot, TUint8 aTag, const TDesC8 &aData)
+{
+    iCoded.Zero();
+    iCoded.Append(aTag | KKeyframe);
+    iCoded.Append(aData);
+
+    Mem::Copy(iReference + aSlot * KMaxLength, aData.Ptr(), aData.Length());
+    iLength[aSlot]   = aData.Length();
+    iSinceKey[aSlot] = 0;
+
+    return iCoded;
+}
+
+TBool CGameBTCommsDelta::Decode(TInt aSlot, TUint8 aTag, const TDesC8 &aBody, TPtrC8 &aData)
+{
+    TUint8 *reference = iReference + aSlot * KMaxLength;
+    TInt    length    = iLength[aSlot];
+    TInt    index     = 0;
+    TInt    offset    = 0;
+    TBool   valid     = ETrue;
+
+    if (aTag & KKeyframe)
+    {
+        if ((aBody.Length() == 0) || (aBody.Length() > KMaxLength))
+        {
+            Invalidate(aSlot);
+            return EFalse;
+        }
+
+        Mem::Copy(reference, aBody.Ptr(), aBody.Length());
+        iLength[aSlot] = aBody.Length();
+        aData.Set(reference, aBody.Length());
+        return ETrue;
+    }
+
+    if (length == 0)
+    {
+        return EFalse; /* No reference yet, wait for a keyframe. */
+    }
+
+    while (offset < aBody.Length())
+    {
+        TUint8 token = aBody[offset];
+        TInt   run   = (token & 0x7f) + 1;
+
+        offset += 1;
+
+        if (index + run > length)
+        {
+            valid = EFalse;
+            break;
+        }
+
+        if (! (token & 0x80))
+        {
+            if (offset + run > aBody.Length())
+            {
+                valid = EFalse;
+                break;
+            }
+
+            for (TInt byte = 0; byte < run; byte += 1)
+            {
+                reference[index + byte] ^= aBody[offset + byte];
+            }
+            offset += run;
+        }
+        index += run;
+    }
+
+    if ((! valid) || (index != length))
+    {
+        /* Partly applied, the reference is lost until the next keyframe. */
+        Invalidate(aSlot);
+        return EFalse;
+    }
+
+    aData.Set(reference, length);
+    return ETrue;
+}
+
+void CGameBTCommsDelta::Invalidate(TInt aSlot)
+{
+    iLength[aSlot]   = 0;
+    iSinceKey[aSlot] = 0;
+}
+
+void CGameBTCommsDelta::Reset()
+{
+    Mem::FillZ(iLength, iSlots * sizeof(TInt));
+    Mem::FillZ(iSinceKey, iSlots * sizeof(TInt));
+}
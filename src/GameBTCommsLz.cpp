@@ -0,0 +1,114 @@
+/** @file GameBTCommsLz.cpp
+ *
+ *  Byte oriented LZ compressor for batches of frames.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <e32def.h>
+#include <e32std.h>
+
+#include "GameBTCommsLz.h"
+
+CGameBTCommsLz *CGameBTCommsLz::NewL()
+{
+    return new (ELeave) CGameBTCommsLz;
+}
+
+CGameBTCommsLz::CGameBTCommsLz()
+{
+}
+
+TInt CGameBTCommsLz::PutLength(TUint8 *aOut, TInt aLength)
+{
+    TInt length = 0;
+
+    /* Called with the part of a field above 15. */
+    while (aLength >= 255)
+    {
+        aOut[length++] = 255;
+        aLength       -= 255;
+    }
+    aOut[length++] = (TUint8)aLength;
+
+    return length;
+}
+
+TInt CGameBTCommsLz::Compress(const TUint8 *aData, TInt aLength, TUint8 *aOut, TInt aMaxLength)
+{
+    TInt anchor   = 0;
+    TInt position = 0;
+    TInt length   = 0;
+
+    Mem::FillZ(iHash, sizeof(iHash));
+
+    while (position + KMinMatch <= aLength)
+    {
+        TUint32 sequence = aData[position] | (aData[position + 1] << 8) |
+                           (aData[position + 2] << 16) | (aData[position + 3] << 24);
+        TUint32 hash      = (sequence * 2654435761U) >> (32 - KHashBits);
+        TInt    candidate = iHash[hash] - 1;
+        TInt    literals;
+        TInt    match;
+
+        iHash[hash] = (TUint16)(position + 1);
+
+        if ((candidate < 0) || (Mem::Compare(&aData[candidate], KMinMatch, &aData[position], KMinMatch) != 0))
+        {
+            position += 1;
+            continue;
+        }
+
+        match = KMinMatch;
+        while ((position + match < aLength) && (aData[candidate + match] == aData[position + match]))
+        {
+            match += 1;
+        }
+
+        /* Worst case size of this sequence: token, both extensions,
+         * literals and offset. */
+        literals = position - anchor;
+        if (length + 1 + (literals / 255 + 1) + literals + 2 + ((match - KMinMatch) / 255 + 1) > aMaxLength)
+        {
+            return 0;
+        }
+
+        aOut[length++] = (TUint8)((Min(literals, 15) << 4) | Min(match - KMinMatch, 15));
+        if (literals >= 15)
+        {
+            length += PutLength(&aOut[length], literals - 15);
+        }
+        Mem::Copy(&aOut[length], &aData[anchor], literals);
+        length += literals;
+
+        aOut[length++] = (TUint8)((position - candidate) & 0xff);
+        aOut[length++] = (TUint8)((position - candidate) >> 8);
+        if (match - KMinMatch >= 15)
+        {
+            length += PutLength(&aOut[length], match - KMinMatch - 15);
+        }
+
+        position += match;
+        anchor    = position;
+    }
+
+    /* The remaining bytes go out as literals without a match. */
+    TInt literals = aLength - anchor;
+
+    if (length + 1 + (literals / 255 + 1) + literals > aMaxLength)
+    {
+        return 0;
+    }
+
+    aOut[length++] = (TUint8)(Min(literals, 15) << 4);
+    if (literals >= 15)
+    {
+        length += PutLength(&aOut[length], literals - 15);
+    }
+    Mem::Copy(&aOut[length], &aData[anchor], literals);
+    length += literals;
+
+    return length;
+}
@@ -0,0 +1,174 @@
+/** @file GameBTCommsRing.cpp
+ *
+ *  Contiguous ring arena holding variable-length records.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <e32def.h>
+#include <e32std.h>
+
+#include "GameBTCommsRing.h"
+
+CGameBTCommsRing *CGameBTCommsRing::NewL(TInt aSize)
+{
+    CGameBTCommsRing *self = new (ELeave) CGameBTCommsRing;
+
+    CleanupStack::PushL(self);
+    self->ConstructL(aSize);
+    CleanupStack::Pop();
+
+    return self;
+}
+
+CGameBTCommsRing::CGameBTCommsRing()
+{
+}
+
+CGameBTCommsRing::~CGameBTCommsRing()
+{
+    User::Free(iArena);
+}
+
+void CGameBTCommsRing::ConstructL(TInt aSize)
+{
+    iArena     = (TUint8 *)User::AllocL(aSize);
+    iSize      = aSize;
+    iRead      = 0;
+    iWrite     = 0;
+    iWatermark = aSize;
+    iReserved  = -1;
+}
+
+TUint8 *CGameBTCommsRing::Reserve(TInt aLength)
+{
+    if ((aLength <= 0) || (aLength >= iSize) || (iReserved >= 0))
+    {
+        return NULL;
+    }
+
+    if (iWrite >= iRead)
+    {
+        if (iSize - iWrite >= aLength)
+        {
+            iReserved = iWrite;
+        }
+        else if (iRead > aLength)
+        {
+            iReserved = 0; /* Skip the tail, the reader stops at iWatermark. */
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    else if (iRead - iWrite > aLength)
+    {
+        iReserved = iWrite;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    return iArena + iReserved;
+}
+
+void CGameBTCommsRing::Commit(TInt aLength)
+{
+    if (iReserved < 0)
+    {
+        return;
+    }
+
+    if (iReserved != iWrite)
+    {
+        iWatermark = iWrite;
+        iWrite     = aLength;
+    }
+    else
+    {
+        iWrite += aLength;
+    }
+
+    iReserved = -1;
+}
+
+TPtrC8 CGameBTCommsRing::Readable(TInt aOffset) const
+{
+    TInt start = iRead + aOffset;
+
+    if (iWrite >= iRead)
+    {
+        return TPtrC8(iArena + start, iWrite - start);
+    }
+
+    if (start < iWatermark)
+    {
+        return TPtrC8(iArena + start, iWatermark - start);
+    }
+
+    /* The skipped bytes cover the whole tail, continue behind the wrap. */
+    start -= iWatermark;
+
+    return TPtrC8(iArena + start, iWrite - start);
+}
+
+void CGameBTCommsRing::Consume(TInt aLength)
+{
+    TBool wrapped = (iWrite < iRead);
+
+    iRead += aLength;
+
+    if (wrapped && (iRead >= iWatermark))
+    {
+        iRead      = 0;
+        iWatermark = iSize;
+    }
+
+    if ((iRead == iWrite) && (iReserved < 0))
+    {
+        /* Empty: rewind so the next record gets the whole arena. */
+        iRead  = 0;
+        iWrite = 0;
+    }
+}
+
+CGameBTCommsRing::TMark CGameBTCommsRing::Mark() const
+{
+    TMark mark;
+
+    mark.iWrite     = iWrite;
+    mark.iWatermark = iWatermark;
+
+    return mark;
+}
+
+void CGameBTCommsRing::Rewind(const TMark &aMark)
+{
+    iWrite     = aMark.iWrite;
+    iWatermark = aMark.iWatermark;
+    iReserved  = -1;
+}
+
+TInt CGameBTCommsRing::Size() const
+{
+    return iSize;
+}
+
+TInt CGameBTCommsRing::Used() const
+{
+    if (iWrite >= iRead)
+    {
+        return iWrite - iRead;
+    }
+
+    return (iWatermark - iRead) + iWrite;
+}
+
+TBool CGameBTCommsRing::IsEmpty() const
+{
+    return (iRead == iWrite);
+}
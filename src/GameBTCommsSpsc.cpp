@@ -0,0 +1,109 @@
+/** @file GameBTCommsSpsc.cpp
+ *
+ *  Lock-free byte ring shared by exactly one producer thread and one
+ *  consumer thread.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <e32def.h>
+#include <e32std.h>
+
+#include "GameBTCommsSpsc.h"
+
+CGameBTCommsSpsc *CGameBTCommsSpsc::NewL(TInt aSize)
+{
+    CGameBTCommsSpsc *self = new (ELeave) CGameBTCommsSpsc;
+
+    CleanupStack::PushL(self);
+    self->ConstructL(aSize);
+    CleanupStack::Pop();
+
+    return self;
+}
+
+CGameBTCommsSpsc::CGameBTCommsSpsc()
+{
+}
+
+CGameBTCommsSpsc::~CGameBTCommsSpsc()
+{
+    User::Free(iRing);
+}
+
+void CGameBTCommsSpsc::ConstructL(TInt aSize)
+{
+    iRing = (TUint8 *)User::AllocL(aSize);
+    iSize = aSize;
+    iHead = 0;
+    iTail = 0;
+}
+
+TInt CGameBTCommsSpsc::Write(const TDesC8 &aData)
+{
+    TInt length = Min(aData.Length(), Free());
+    TInt start  = iHead;
+    TInt first  = Min(length, iSize - start);
+
+    Mem::Copy(iRing + start, aData.Ptr(), first);
+    Mem::Copy(iRing, aData.Ptr() + first, length - first);
+
+    /* Publish only after the data is in place. */
+    iHead = (start + length) % iSize;
+
+    return length;
+}
+
+TPtrC8 CGameBTCommsSpsc::Readable(TInt aOffset) const
+{
+    TInt start  = (iTail + aOffset) % iSize;
+    TInt length = Used() - aOffset;
+
+    return TPtrC8(iRing + start, Min(length, iSize - start));
+}
+
+TInt CGameBTCommsSpsc::Read(TDes8 &aBuffer)
+{
+    TInt   moved = 0;
+    TPtrC8 span  = Readable();
+
+    /* At most two spans: up to the end of the ring and from its start. */
+    for (TInt pass = 0; (pass < 2) && (span.Length() > 0); pass += 1)
+    {
+        TInt length = Min(span.Length(), aBuffer.MaxLength() - aBuffer.Length());
+
+        aBuffer.Append(span.Left(length));
+        Consume(length);
+        moved += length;
+
+        span.Set(Readable());
+    }
+
+    return moved;
+}
+
+void CGameBTCommsSpsc::Consume(TInt aLength)
+{
+    iTail = (iTail + aLength) % iSize;
+}
+
+TInt CGameBTCommsSpsc::Size() const
+{
+    return iSize;
+}
+
+TInt CGameBTCommsSpsc::Used() const
+{
+    TInt head = iHead;
+    TInt tail = iTail;
+
+    return (head - tail + iSize) % iSize;
+}
+
+TInt CGameBTCommsSpsc::Free() const
+{
+    /* One byte stays unused to tell a full ring from an empty one. */
+    return iSize - 1 - Used();
+}
@@ -0,0 +1,492 @@
+/** @file GameBTCommsThread.cpp
+ *
+ *  Runs the Bluetooth link in a thread of its own.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <e32def.h>
+#include <e32std.h>
+
+#include "GameBTCommsSpsc.h"
+#include "GameBTCommsThread.h"
+#include "MessageClient.h"
+
+_LIT(KThreadName, "GameBTComms%08X%02X");
+
+const TInt KThreadHeapSize = 0x10000;
+const TInt KThreadNameTries = 16;
+
+/**
+ * @brief Comms thread side: owns the CMessageClient and moves data
+ *        between it and the rings.
+ */
+class CGameBTCommsWorker : public CActive, public MMessageClientObserver
+{
+public:
+    static CGameBTCommsWorker *NewL(TGameBTCommsShared &aShared);
+    ~CGameBTCommsWorker();
+    void StartL();
+
+protected:
+    void RunL();
+    void DoCancel();
+
+private:
+    CGameBTCommsWorker(TGameBTCommsShared &aShared);
+    void ConstructL();
+    void Arm();
+    TBool TakeWake();
+    void PumpL();
+    void Pump();
+    static TInt TickCallBack(TAny *aSelf);
+
+    /* From MMessageClientObserver */
+    void WriteComplete(const TDesC8 &aData, TInt aError);
+    TInt ReadComplete(const TDesC8 &aData);
+
+private:
+    TGameBTCommsShared &iShared;   ///< Rings and flags used by both threads
+    CMessageClient     *iClient;   ///< The link itself
+    CPeriodic          *iTick;     ///< Publishes the link state and notices iStop
+    TInt                iInFlight; ///< Bytes of the outbound ring handed to iClient
+};
+
+CGameBTCommsWorker *CGameBTCommsWorker::NewL(TGameBTCommsShared &aShared)
+{
+    CGameBTCommsWorker *self = new (ELeave) CGameBTCommsWorker(aShared);
+
+    CleanupStack::PushL(self);
+    self->ConstructL();
+    CleanupStack::Pop();
+
+    return self;
+}
+
+CGameBTCommsWorker::CGameBTCommsWorker(TGameBTCommsShared &aShared)
+: CActive(CActive::EPriorityStandard),
+  iShared(aShared),
+  iInFlight(0)
+{
+    CActiveScheduler::Add(this);
+}
+
+CGameBTCommsWorker::~CGameBTCommsWorker()
+{
+    Cancel();
+
+    if (iClient && iClient->IsConnected())
+    {
+        TRAPD(error, iClient->DisconnectL());
+        (void)error;
+    }
+
+    delete iTick;
+    delete iClient;
+}
+
+void CGameBTCommsWorker::ConstructL()
+{
+    iClient = CMessageClient::NewL(this);
+    iTick   = CPeriodic::NewL(CActive::EPriorityStandard);
+}
+
+void CGameBTCommsWorker::StartL()
+{
+    iShared.iWakeStatus = &iStatus;
+
+    iClient->ConnectL();
+    Arm();
+
+    iTick->Start(iShared.iInterval, iShared.iInterval, TCallBack(TickCallBack, this));
+
+    /* Tell ConnectL() that the link is up, a leave before this point
+     * ends the thread and is reported there instead. */
+    RThread owner;
+
+    User::LeaveIfError(owner.Open(iShared.iOwner));
+    owner.RequestComplete(iShared.iStartStatus, KErrNone);
+    owner.Close();
+}
+
+void CGameBTCommsWorker::Arm()
+{
+    iStatus = KRequestPending;
+    SetActive();
+
+    User::LockedInc(iShared.iArmed);
+}
+
+TBool CGameBTCommsWorker::TakeWake()
+{
+    /* Whoever takes iArmed from 1 to 0 completes iStatus, so it is
+     * never completed twice. */
+    if (User::LockedDec(iShared.iArmed) == 1)
+    {
+        return ETrue;
+    }
+
+    User::LockedInc(iShared.iArmed);
+
+    return EFalse;
+}
+
+void CGameBTCommsWorker::RunL()
+{
+    if (iShared.iStop)
+    {
+        CActiveScheduler::Stop();
+        return;
+    }
+
+    Arm();
+    Pump();
+}
+
+void CGameBTCommsWorker::DoCancel()
+{
+    if (TakeWake())
+    {
+        TRequestStatus *status = &iStatus;
+        User::RequestComplete(status, KErrCancel);
+    }
+    /* Otherwise the game thread is completing it right now. */
+}
+
+TInt CGameBTCommsWorker::TickCallBack(TAny *aSelf)
+{
+    CGameBTCommsWorker *self = (CGameBTCommsWorker *)aSelf;
+
+    if (self->iShared.iStop && self->IsActive() && self->TakeWake())
+    {
+        /* The game thread set iStop while RunL was running. */
+        TRequestStatus *status = &self->iStatus;
+        User::RequestComplete(status, KErrNone);
+        return 0;
+    }
+
+    self->Pump();
+
+    return 0;
+}
+
+void CGameBTCommsWorker::Pump()
+{
+    TRAPD(error, PumpL());
+    (void)error; /* Retried on the next tick. */
+
+    iShared.iConnected = iClient->IsConnected();
+    iShared.iIoStats   = iClient->IoStats();
+}
+
+void CGameBTCommsWorker::PumpL()
+{
+    TUint8 data[CMessageClient::KReceiveBufferLength];
+    TPtrC8 span;
+
+    /* Received data that did not fit into the inbound ring before. */
+    while ((iClient->BufferedLength() > 0) && (iShared.iInbound->Free() > 0))
+    {
+        TPtr8 chunk(data, 0, Min((TInt)sizeof(data), iShared.iInbound->Free()));
+
+        iClient->PollMessagesL(chunk);
+        iShared.iInbound->Write(chunk);
+    }
+
+    /* Write straight from the outbound ring, it is consumed on completion. */
+    while (iClient->IsReadyToSendMessage())
+    {
+        span.Set(iShared.iOutbound->Readable(iInFlight));
+        if (span.Length() == 0)
+        {
+            break;
+        }
+
+        iClient->WriteL(span);
+        iInFlight += span.Length();
+    }
+}
+
+void CGameBTCommsWorker::WriteComplete(const TDesC8 &aData, TInt aError)
+{
+    iShared.iOutbound->Consume(aData.Length());
+    iInFlight -= aData.Length();
+
+    if (aError == KErrNone)
+    {
+        Pump();
+    }
+}
+
+TInt CGameBTCommsWorker::ReadComplete(const TDesC8 &aData)
+{
+    if (iClient->BufferedLength() > 0)
+    {
+        return 0; /* Older data goes first, PumpL() moves it. */
+    }
+
+    return iShared.iInbound->Write(aData);
+}
+
+CGameBTCommsThread *CGameBTCommsThread::NewL(MMessageClientObserver *aObserver, TInt aRingSize, TInt aMaxWrite, TInt aInterval)
+{
+    CGameBTCommsThread *self = new (ELeave) CGameBTCommsThread(aObserver, aMaxWrite);
+
+    CleanupStack::PushL(self);
+    self->ConstructL(aRingSize, aInterval);
+    CleanupStack::Pop();
+
+    return self;
+}
+
+CGameBTCommsThread::CGameBTCommsThread(MMessageClientObserver *aObserver, TInt aMaxWrite)
+: CActive(CActive::EPriorityStandard),
+  iObserver(aObserver),
+  iMaxWrite(aMaxWrite),
+  iRunning(EFalse),
+  iCompletedCount(0)
+{
+    CActiveScheduler::Add(this);
+}
+
+CGameBTCommsThread::~CGameBTCommsThread()
+{
+    Stop();
+    Cancel();
+
+    delete iShared.iOutbound;
+    delete iShared.iInbound;
+}
+
+void CGameBTCommsThread::ConstructL(TInt aRingSize, TInt aInterval)
+{
+    Mem::FillZ(&iShared, sizeof(iShared));
+
+    iShared.iOutbound = CGameBTCommsSpsc::NewL(aRingSize);
+    iShared.iInbound  = CGameBTCommsSpsc::NewL(aRingSize);
+    iShared.iInterval = aInterval;
+}
+
+TInt CGameBTCommsThread::ThreadFunction(TAny *aShared)
+{
+    CTrapCleanup *cleanup = CTrapCleanup::New();
+
+    if (! cleanup)
+    {
+        return KErrNoMemory;
+    }
+
+    TRAPD(error, RunThreadL(*(TGameBTCommsShared *)aShared));
+
+    delete cleanup;
+
+    return error;
+}
+
+void CGameBTCommsThread::RunThreadL(TGameBTCommsShared &aShared)
+{
+    CActiveScheduler  *scheduler = new (ELeave) CActiveScheduler;
+    CGameBTCommsWorker *worker;
+
+    CleanupStack::PushL(scheduler);
+    CActiveScheduler::Install(scheduler);
+
+    worker = CGameBTCommsWorker::NewL(aShared);
+    CleanupStack::PushL(worker);
+
+    worker->StartL();
+    CActiveScheduler::Start();
+
+    CleanupStack::PopAndDestroy(2); /* worker, scheduler */
+}
+
+void CGameBTCommsThread::ConnectL()
+{
+    if (iRunning)
+    {
+        return;
+    }
+
+    TBuf<32>       name;
+    TInt           error = KErrAlreadyExists;
+    TRequestStatus started(KRequestPending);
+
+    /* Thread names are global, and the thread of an earlier instance may
+     * still be exiting, so each instance and try gets a name of its own.
+     * EKA1 has no anonymous threads. */
+    for (TInt attempt = 0; (error == KErrAlreadyExists) && (attempt < KThreadNameTries); attempt += 1)
+    {
+        name.Format(KThreadName, (TUint)this, (TUint)((User::TickCount() + attempt) & 0xff));
+        error = iThread.Create(name, ThreadFunction, KDefaultStackSize, KMinHeapSize, KThreadHeapSize, &iShared);
+    }
+    User::LeaveIfError(error);
+
+    iShared.iOwner       = RThread().Id();
+    iShared.iStartStatus = &started;
+
+    iThread.Logon(iThreadStatus);
+    iThread.Resume();
+
+    /* Only waits for the comms thread to post its first requests, the
+     * connection itself is still made asynchronously. */
+    User::WaitForRequest(started, iThreadStatus);
+    if (started == KRequestPending)
+    {
+        /* The thread ended before its link was up. */
+        error = iThreadStatus.Int();
+        iThread.Close();
+        iShared.iWakeStatus = NULL;
+        iShared.iArmed      = 0;
+        User::Leave((error != KErrNone) ? error : KErrGeneral);
+    }
+
+    iRunning = ETrue;
+}
+
+void CGameBTCommsThread::DisconnectL()
+{
+    Stop();
+}
+
+void CGameBTCommsThread::Stop()
+{
+    if (! iRunning)
+    {
+        return;
+    }
+
+    iShared.iStop = ETrue;
+    Wake();
+
+    User::WaitForRequest(iThreadStatus);
+    iThread.Close();
+
+    iRunning            = EFalse;
+    iShared.iWakeStatus = NULL;
+    iShared.iConnected  = EFalse;
+    iShared.iStop       = EFalse;
+    iShared.iArmed      = 0;
+}
+
+void CGameBTCommsThread::Wake()
+{
+    if (! iShared.iWakeStatus)
+    {
+        return; /* Not started yet, the first tick picks the data up. */
+    }
+
+    if (User::LockedDec(iShared.iArmed) == 1)
+    {
+        TRequestStatus *status = iShared.iWakeStatus;
+        iThread.RequestComplete(status, KErrNone);
+    }
+    else
+    {
+        User::LockedInc(iShared.iArmed);
+    }
+}
+
+TBool CGameBTCommsThread::IsConnected()
+{
+    return iShared.iConnected;
+}
+
+TBool CGameBTCommsThread::IsReadyToSendMessage()
+{
+    /* The largest write fits, so CopyL() cannot fail after the caller
+     * has encoded its frames. */
+    return (iShared.iConnected &&
+            (iCompletedCount < KMaxCompletions) &&
+            (iShared.iOutbound->Free() >= iMaxWrite));
+}
+
+void CGameBTCommsThread::CopyL(const TDesC8 &aData)
+{
+    if (! iShared.iConnected)
+    {
+        User::Leave(KErrDisconnected);
+    }
+
+    if (aData.Length() > iShared.iOutbound->Free())
+    {
+        User::Leave(KErrOverflow);
+    }
+
+    iShared.iOutbound->Write(aData);
+    Wake();
+}
+
+void CGameBTCommsThread::SendMessageL(const TDesC8 &aMessage)
+{
+    CopyL(aMessage);
+}
+
+void CGameBTCommsThread::WriteL(const TDesC8 &aData)
+{
+    if (iCompletedCount >= KMaxCompletions)
+    {
+        User::Leave(KErrNotReady);
+    }
+
+    CopyL(aData);
+
+    /* The data has been copied, report it from the scheduler so the
+     * caller never sees WriteComplete() from within WriteL(). */
+    iCompleted[iCompletedCount].Set(aData);
+    iCompletedCount += 1;
+
+    if (! IsActive())
+    {
+        TRequestStatus *status = &iStatus;
+
+        iStatus = KRequestPending;
+        SetActive();
+        User::RequestComplete(status, KErrNone);
+    }
+}
+
+void CGameBTCommsThread::RunL()
+{
+    while (iCompletedCount > 0)
+    {
+        TPtrC8 data(iCompleted[0]);
+
+        for (TInt index = 1; index < iCompletedCount; index += 1)
+        {
+            iCompleted[index - 1].Set(iCompleted[index]);
+        }
+        iCompletedCount -= 1;
+
+        if (iObserver)
+        {
+            iObserver->WriteComplete(data, KErrNone);
+        }
+    }
+}
+
+void CGameBTCommsThread::DoCancel()
+{
+    /* Only ever completed by this thread, and always right away. */
+}
+
+TBool CGameBTCommsThread::PollMessagesL(TDes8 &aBuffer)
+{
+    iShared.iInbound->Read(aBuffer);
+
+    /* There may be room now for data the comms thread had to keep. */
+    Wake();
+
+    return (iShared.iInbound->Used() > 0);
+}
+
+TInt CGameBTCommsThread::BufferedLength() const
+{
+    return iShared.iInbound->Used();
+}
+
+const TMessageIoStats &CGameBTCommsThread::IoStats() const
+{
+    return iShared.iIoStats;
+}
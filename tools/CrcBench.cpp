@@ -0,0 +1,215 @@
+/** @file CrcBench.cpp
+ *
+ *  Agreement and speed of the batch CRC.
+ *
+ *  TGameBTCommsCrc and the hub's crc16() must give the same checksum
+ *  for every input, both are timed on the same data.  A session with
+ *  [Crc] enabled then corrupts one batch in each direction: it must be
+ *  dropped and counted, and the batches after it delivered.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "GameBTCommsCrc.h"
+#include "HostLink.h"
+#include "HostSession.h"
+#include "codec.h"
+
+enum
+{
+    KBufferSize = 256,  ///< Largest batch the device sends
+    KBuffers    = 4096, ///< Inputs compared
+    KRepeats    = 200,  ///< Timed runs over all inputs
+    KMessages   = 200   ///< Messages of the session before and after the corrupt write
+};
+
+static TUint8 data[KBuffers][KBufferSize];
+
+static double Seconds(clock_t aStart)
+{
+    return (double)(clock() - aStart) / CLOCKS_PER_SEC;
+}
+
+static TInt CompareL()
+{
+    const char   check[]   = "123456789";
+    unsigned int noise     = 1;
+    TInt         disagree  = 0;
+    TUint32      sum       = 0;
+    double       bytes     = (double)KBuffers * KBufferSize * KRepeats;
+    clock_t      start;
+    double       device;
+    double       hub;
+
+    /* The check value of CRC-16/CCITT-FALSE */
+    if (TGameBTCommsCrc::Crc16((const TUint8 *)check, 9) != 0x29b1)
+    {
+        disagree += 1;
+    }
+
+    for (TInt buffer = 0; buffer < KBuffers; buffer += 1)
+    {
+        for (TInt byte = 0; byte < KBufferSize; byte += 1)
+        {
+            noise              = noise * 1103515245 + 12345;
+            data[buffer][byte] = (TUint8)(noise >> 24);
+        }
+
+        /* Every length, including the empty batch */
+        TInt length = buffer % (KBufferSize + 1);
+
+        if (TGameBTCommsCrc::Crc16(data[buffer], length) != crc16((const char *)data[buffer], length))
+        {
+            disagree += 1;
+        }
+    }
+
+    start = clock();
+    for (TInt run = 0; run < KRepeats; run += 1)
+    {
+        for (TInt buffer = 0; buffer < KBuffers; buffer += 1)
+        {
+            sum += TGameBTCommsCrc::Crc16(data[buffer], KBufferSize);
+        }
+    }
+    device = Seconds(start);
+
+    start = clock();
+    for (TInt run = 0; run < KRepeats; run += 1)
+    {
+        for (TInt buffer = 0; buffer < KBuffers; buffer += 1)
+        {
+            sum += crc16((const char *)data[buffer], KBufferSize);
+        }
+    }
+    hub = Seconds(start);
+
+    printf("%d inputs, %d disagree, device %.1f MB/s, hub %.1f MB/s (host, sum %08x)\n",
+           KBuffers, disagree, bytes / device / 1e6, bytes / hub / 1e6, (unsigned int)sum);
+
+    return disagree;
+}
+
+/* A batch from client 1 holding one message, corrupted on request */
+static void SendBatch(const char *aMessage, TBool aCorrupt)
+{
+    TBuf8<64> batch;
+    TUint16   crc;
+
+    batch.Append(0x02);
+    batch.Append((TChar)strlen(aMessage));
+    batch.Append((const TUint8 *)aMessage, (TInt)strlen(aMessage));
+
+    crc = TGameBTCommsCrc::Crc16(batch.Ptr(), batch.Length());
+    batch.Append(0x07);
+    batch.Append(0x02);
+    batch.Append(crc & 0xff);
+    batch.Append(crc >> 8);
+
+    if (aCorrupt)
+    {
+        batch[2] ^= 0x01;
+    }
+
+    HostLink::Send(batch);
+}
+
+static TInt SendMessagesL(CGameBTComms &aComms, TInt aCount)
+{
+    for (TInt sent = 0; sent < aCount;)
+    {
+        TBuf8<32> message;
+        TInt      error;
+
+        message.Copy((const TUint8 *)"SNAPSHOT", 8);
+        message.Append((TChar)sent);
+
+        error = aComms.SendDataToAllClients(message, CGameBTComms::EReliableOrdered, 0);
+        if (error == KErrOverflow)
+        {
+            HostSpin(0);
+            aComms.Pump();
+            continue;
+        }
+        User::LeaveIfError(error);
+        sent += 1;
+    }
+
+    aComms.Flush();
+    HostSpin(20000);
+
+    return HostLink::Stats().iFrames;
+}
+
+static TInt PlaySessionL()
+{
+    THostNotify              notify;
+    CGameBTComms            *comms;
+    CMessageClient::TIoStats io;
+    TInt                     frames[3];
+    TInt                     received[3];
+
+    HostWriteIni("[Crc]\nEnabled=1\n");
+
+    comms = HostStartL(notify);
+    CleanupStack::PushL(comms);
+
+    /* Device to hub: one corrupt write among clean ones */
+    frames[0] = SendMessagesL(*comms, KMessages);
+    HostLink::CorruptNextWrite(3);
+    frames[1] = SendMessagesL(*comms, KMessages);
+    frames[2] = SendMessagesL(*comms, KMessages);
+
+    const THostHubStats &stats = HostLink::Stats();
+
+    printf("device to hub: %d batches, %d corrupt, messages received %d, %d, %d of %d each\n",
+           stats.iBatches, stats.iCorruptBatches, frames[0], frames[1] - frames[0], frames[2] - frames[1], KMessages);
+
+    /* Hub to device: clean, corrupt, clean */
+    SendBatch("first", EFalse);
+    HostSpin(20000);
+    comms->Pump();
+    received[0] = notify.iReceived;
+
+    SendBatch("second", ETrue);
+    HostSpin(20000);
+    comms->Pump();
+    received[1] = notify.iReceived;
+
+    SendBatch("third", EFalse);
+    HostSpin(20000);
+    comms->Pump();
+    received[2] = notify.iReceived;
+
+    comms->GetIoStats(io);
+
+    printf("hub to device: received %d, %d, %d, %u corrupt\n", received[0], received[1], received[2], (unsigned int)io.iCorruptBatches);
+
+    CleanupStack::PopAndDestroy(comms);
+
+    return ((frames[0] == KMessages) && (frames[1] - frames[0] < KMessages) && (frames[2] - frames[1] == KMessages) &&
+            (stats.iCorruptBatches == 1) &&
+            (received[0] == 1) && (received[1] == 1) && (received[2] == 2) && (io.iCorruptBatches == 1)) ? 0 : 1;
+}
+
+static void MainL()
+{
+    TInt failures = CompareL();
+
+    failures += PlaySessionL();
+    if (failures)
+    {
+        User::Leave(KErrCorrupt);
+    }
+}
+
+int main()
+{
+    return HostMain(MainL);
+}
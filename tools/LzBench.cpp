@@ -0,0 +1,261 @@
+/** @file LzBench.cpp
+ *
+ *  Ratio and speed of the block compression on game traffic.
+ *
+ *  The first part compresses synthetic protocol 2 blocks of a four
+ *  player action game with CGameBTCommsLz and expands them with the
+ *  hub's lz_decompress().  The second part plays the same traffic
+ *  through the library with [Compress] enabled and checks that the
+ *  hub end of the host link receives every payload unchanged.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "GameBTCommsLz.h"
+#include "HostLink.h"
+#include "HostSession.h"
+#include "codec.h"
+
+enum
+{
+    KBlocks      = 2000, ///< Blocks compressed by the first part
+    KRepeats     = 50,   ///< Timed runs per block
+    KMessages    = 4000, ///< Messages sent by the second part
+    KSnapshot    = 24,   ///< Size of a state snapshot
+    KEventPeriod = 7     ///< Ticks between two events
+};
+
+static const char KEvent[] = "EVT:SCORE:PLAYER2:+100";
+
+static unsigned int noise = 1;
+
+/* State snapshot of one player at aTick, one byte of input noise */
+static void Snapshot(TUint8 *aOut, TInt aTick, TInt aPlayer)
+{
+    TInt x = 1000 + aTick * 3 + aPlayer * 50;
+    TInt y = 500 - aTick + aPlayer * 7;
+
+    memset(aOut, 0, KSnapshot);
+    aOut[0] = 1;
+    aOut[1] = (TUint8)aPlayer;
+    aOut[2] = (TUint8)x;
+    aOut[3] = (TUint8)(x >> 8);
+    aOut[4] = (TUint8)y;
+    aOut[5] = (TUint8)(y >> 8);
+    aOut[6] = (TUint8)(aTick * 5);
+    aOut[7] = (TUint8)(100 - (aTick % 100));
+
+    noise   = noise * 1103515245 + 12345;
+    aOut[8] = (TUint8)(noise >> 24);
+}
+
+/* Protocol 2 block as EHandleMessages collects it: stamped snapshots
+ * on a channel, now and then an event to all, as many as fit. */
+static TInt MakeBlock(TUint8 *aBlock, TInt aTick)
+{
+    TInt length = 0;
+    TInt event  = (TInt)strlen(KEvent);
+
+    while (length + 5 + KSnapshot + 4 + event <= CGameBTCommsLz::KMaxBlockSize)
+    {
+        TInt player = 2 + (aTick % 3);
+
+        aBlock[length++] = (TUint8)(player | 0x10);
+        aBlock[length++] = KSnapshot;
+        aBlock[length++] = 0;
+        aBlock[length++] = (TUint8)aTick;
+        aBlock[length++] = (TUint8)(aTick >> 8);
+        Snapshot(&aBlock[length], aTick, player);
+        length += KSnapshot;
+
+        if ((aTick % KEventPeriod) == 0)
+        {
+            aBlock[length++] = 0x05;
+            aBlock[length++] = (TUint8)event;
+            aBlock[length++] = (TUint8)aTick;
+            aBlock[length++] = (TUint8)(aTick >> 8);
+            memcpy(&aBlock[length], KEvent, event);
+            length += event;
+        }
+
+        aTick += 1;
+    }
+
+    return length;
+}
+
+static double Seconds(clock_t aStart)
+{
+    return (double)(clock() - aStart) / CLOCKS_PER_SEC;
+}
+
+static TInt BenchBlocksL()
+{
+    CGameBTCommsLz *lz         = CGameBTCommsLz::NewL();
+    TUint8          in[CGameBTCommsLz::KMaxBlockSize];
+    TUint8          out[CGameBTCommsLz::KMaxBlockSize];
+    TUint8          back[CGameBTCommsLz::KMaxBlockSize];
+    double          raw        = 0;
+    double          wire       = 0;
+    double          compress   = 0;
+    double          decompress = 0;
+    TInt            mismatches = 0;
+
+    CleanupStack::PushL(lz);
+
+    for (TInt block = 0; block < KBlocks; block += 1)
+    {
+        TInt    length = MakeBlock(in, block * 17);
+        TInt    packed = 0;
+        int     size   = 0;
+        clock_t start  = clock();
+
+        for (TInt run = 0; run < KRepeats; run += 1)
+        {
+            packed = lz->Compress(in, length, out, length - 4);
+        }
+        compress += Seconds(start) / KRepeats;
+        raw      += length;
+
+        if (packed == 0)
+        {
+            wire += length; /* Sent as it is */
+            continue;
+        }
+        wire += 3 + packed;
+
+        start = clock();
+        for (TInt run = 0; run < KRepeats; run += 1)
+        {
+            size = lz_decompress(out, packed, back, sizeof(back));
+        }
+        decompress += Seconds(start) / KRepeats;
+
+        if ((size != length) || (memcmp(back, in, length) != 0))
+        {
+            mismatches += 1;
+        }
+    }
+
+    CleanupStack::PopAndDestroy(lz);
+
+    printf("blocks %d, raw %.0f bytes, on the wire %.0f bytes, ratio %.2f, round trip mismatches %d\n",
+           KBlocks, raw, wire, raw / wire, mismatches);
+    printf("compress %.1f MB/s, decompress %.1f MB/s (host)\n", raw / compress / 1e6, raw / decompress / 1e6);
+
+    return mismatches;
+}
+
+/**
+ * @brief Checks the payloads the hub receives against those sent.
+ */
+class TPayloadCheck : public MHostHubObserver
+{
+public:
+    TPayloadCheck() : iNext(0), iMismatches(0) {}
+
+    void FrameReceived(const TUint8 *aFrame, TInt aLength, TInt aHeaderSize)
+    {
+        TUint8 expected[KSnapshot + sizeof(KEvent)];
+        TInt   length = Expected(iNext, expected);
+
+        if ((aLength - aHeaderSize != length) || (memcmp(&aFrame[aHeaderSize], expected, length) != 0))
+        {
+            iMismatches += 1;
+        }
+        iNext += 1;
+    }
+
+    /* Message aIndex of the second part, written to aOut */
+    static TInt Expected(TInt aIndex, TUint8 *aOut)
+    {
+        if ((aIndex % KEventPeriod) == KEventPeriod - 1)
+        {
+            memcpy(aOut, KEvent, strlen(KEvent));
+            return (TInt)strlen(KEvent);
+        }
+
+        Snapshot(aOut, aIndex, 2 + (aIndex % 3));
+        aOut[8] = (TUint8)aIndex; /* Must be reproducible */
+        return KSnapshot;
+    }
+
+public:
+    TInt iNext;       ///< Index of the next expected message
+    TInt iMismatches; ///< Messages that arrived changed
+};
+
+static TInt PlaySessionL()
+{
+    THostNotify   notify;
+    TPayloadCheck check;
+    CGameBTComms *comms;
+    TInt          sent = 0;
+
+    HostWriteIni("[Compress]\nEnabled=1\n");
+    HostLink::SetObserver(&check);
+
+    comms = HostStartL(notify);
+    CleanupStack::PushL(comms);
+
+    while (sent < KMessages)
+    {
+        TUint8 message[KSnapshot + sizeof(KEvent)];
+        TPtr8  data(message, TPayloadCheck::Expected(sent, message), sizeof(message));
+        TInt   error = comms->SendDataToAllClients(data, CGameBTComms::EReliableOrdered, 0);
+
+        if (error == KErrOverflow)
+        {
+            HostSpin(0);
+            comms->Pump();
+            continue;
+        }
+        User::LeaveIfError(error);
+        sent += 1;
+    }
+
+    while (check.iNext < KMessages)
+    {
+        TInt before = check.iNext;
+
+        comms->Flush();
+        HostSpin(1000);
+        if (check.iNext == before)
+        {
+            break; /* Nothing moves any more */
+        }
+    }
+
+    const THostHubStats &stats = HostLink::Stats();
+
+    printf("session: %d messages sent, %d received, %d changed, %d blocks (%d corrupt), payload %d bytes, written %d bytes, ratio %.2f\n",
+           sent, check.iNext, check.iMismatches, stats.iBlocks, stats.iCorruptBlocks, stats.iPayloadBytes,
+           stats.iBytesWritten, (double)stats.iPayloadBytes / stats.iBytesWritten);
+
+    CleanupStack::PopAndDestroy(comms);
+    HostLink::SetObserver(NULL);
+
+    return ((check.iNext == KMessages) && (check.iMismatches == 0) && (stats.iBlocks > 0) && (stats.iCorruptBlocks == 0)) ? 0 : 1;
+}
+
+static void MainL()
+{
+    TInt failures = BenchBlocksL();
+
+    failures += PlaySessionL();
+    if (failures)
+    {
+        User::Leave(KErrCorrupt);
+    }
+}
+
+int main()
+{
+    return HostMain(MainL);
+}
@@ -0,0 +1,130 @@
+/** @file SendBench.cpp
+ *
+ *  Throughput of the send path, from SendDataToClient() and
+ *  SendDataToAllClients() to the bytes written to the socket.
+ *
+ *  Each size is sent once with the hub decoding, which must receive
+ *  every message, and once timed with the hub only counting bytes, so
+ *  that the time is spent in the library.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "HostLink.h"
+#include "HostSession.h"
+
+enum
+{
+    KMessages = 200000, ///< Messages timed per size and function
+    KChecked  = 2000    ///< Messages the hub decodes and counts first
+};
+
+static const TInt KSizes[] = { 8, 32, 128, 255 };
+
+/* Sends aCount messages of aSize bytes, returns the CPU time taken */
+static double SendL(CGameBTComms &aComms, TBool aToAll, TInt aSize, TInt aCount)
+{
+    TUint8  payload[CGameBTComms::KMaxPayloadLength];
+    TPtr8   data(payload, aSize, sizeof(payload));
+    clock_t start = clock();
+
+    for (TInt index = 0; index < aSize; index += 1)
+    {
+        payload[index] = (TUint8)(index * 7);
+    }
+
+    for (TInt sent = 0; sent < aCount;)
+    {
+        TInt error;
+
+        payload[0] = (TUint8)sent;
+
+        if (aToAll)
+        {
+            error = aComms.SendDataToAllClients(data);
+        }
+        else
+        {
+            error = aComms.SendDataToClient(1, data);
+        }
+
+        if (error == KErrOverflow)
+        {
+            /* Completes the writes, the pump sends the rest */
+            CActiveScheduler::RunReady();
+            aComms.Pump();
+            continue;
+        }
+        User::LeaveIfError(error);
+        sent += 1;
+    }
+
+    aComms.Flush();
+    for (TInt round = 0; round < 16; round += 1)
+    {
+        CActiveScheduler::RunReady();
+        aComms.Pump();
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void MainL()
+{
+    THostNotify   notify;
+    CGameBTComms *comms;
+    TInt          failures = 0;
+
+    HostWriteIni("");
+
+    comms = HostStartL(notify);
+    CleanupStack::PushL(comms);
+
+    for (TInt toAll = 0; toAll < 2; toAll += 1)
+    {
+        for (TUint size = 0; size < sizeof(KSizes) / sizeof(KSizes[0]); size += 1)
+        {
+            TInt   frames;
+            TInt   written;
+            double time;
+
+            HostLink::ResetStats();
+            SendL(*comms, toAll, KSizes[size], KChecked);
+            frames = HostLink::Stats().iFrames;
+
+            HostLink::SetDecoding(EFalse);
+            HostLink::ResetStats();
+            time    = SendL(*comms, toAll, KSizes[size], KMessages);
+            written = HostLink::Stats().iBytesWritten;
+            HostLink::SetDecoding(ETrue);
+
+            printf("%-20s %3d bytes: %6.1f MB/s payload, %5.2f Mframes/s, %d bytes written, %d of %d received\n",
+                   toAll ? "SendDataToAllClients" : "SendDataToClient", KSizes[size],
+                   (double)KSizes[size] * KMessages / time / 1e6, KMessages / time / 1e6, written,
+                   frames, KChecked);
+
+            if (frames != KChecked)
+            {
+                failures += 1;
+            }
+        }
+    }
+
+    CleanupStack::PopAndDestroy(comms);
+
+    if (failures)
+    {
+        User::Leave(KErrCorrupt);
+    }
+}
+
+int main()
+{
+    return HostMain(MainL);
+}
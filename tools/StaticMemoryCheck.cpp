@@ -0,0 +1,172 @@
+/** @file StaticMemoryCheck.cpp
+ *
+ *  No heap operation after construction in static memory mode.
+ *
+ *  A session with [Memory] Static=1 sends and receives, including
+ *  fragmented messages both ways and the error paths that would log.
+ *  The cells taken from the emulated User::Alloc() must not change
+ *  after the session has started, and the log file, which fopen()
+ *  would allocate for, must not be written.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "HostLink.h"
+#include "HostSession.h"
+
+#define LOG "E:\\GameBTComms.txt"
+
+enum
+{
+    KMessages       = 2000, ///< Messages sent to the hub
+    KReassemblySize = 512,  ///< Reassembly block set in the ini file
+    KFragment       = 200   ///< Payload of a fragment from the hub
+};
+
+static TUint8 message[CGameBTComms::KMaxMessageLength + 1];
+
+/* A frame from client 1 to the library, aFlags are the fragment flags */
+static void SendFrame(TUint8 aFlags, const TUint8 *aPayload, TInt aLength)
+{
+    TBuf8<3 + KFragment + 2> frame;
+
+    /* Protocol 2, the length is a 7 bit varint */
+    frame.Append(0x02 | aFlags);
+    if (aLength > 0x7f)
+    {
+        frame.Append((aLength & 0x7f) | 0x80);
+        frame.Append(aLength >> 7);
+    }
+    else
+    {
+        frame.Append(aLength);
+    }
+    frame.Append(aPayload, aLength);
+
+    HostLink::Send(frame);
+}
+
+/* The first fragment of a message of aTotal bytes from client 1 */
+static void SendFirst(TInt aTotal)
+{
+    TUint8 first[2 + KFragment];
+
+    first[0] = (TUint8)aTotal;
+    first[1] = (TUint8)(aTotal >> 8);
+    memcpy(&first[2], message, KFragment);
+
+    SendFrame(CGameBTComms::KFragmentMore, first, 2 + KFragment);
+}
+
+/* A message of aTotal bytes from client 1 in fragments */
+static void SendFragmented(TInt aTotal)
+{
+    TInt sent;
+
+    SendFirst(aTotal);
+    for (sent = KFragment; aTotal - sent > KFragment; sent += KFragment)
+    {
+        SendFrame(CGameBTComms::KFragmentMore | CGameBTComms::KFragmentNext, message, KFragment);
+    }
+    SendFrame(CGameBTComms::KFragmentNext, message, aTotal - sent);
+}
+
+/* Sends to the hub, lets the queue run full now and then */
+static TInt SendMessagesL(CGameBTComms &aComms)
+{
+    TInt overflows = 0;
+
+    for (TInt sent = 0; sent < KMessages;)
+    {
+        /* Every tenth message needs fragments */
+        TPtr8 data(message, (sent % 10) ? 24 : 600, sizeof(message));
+        TInt  error;
+
+        message[0] = (TUint8)sent;
+
+        error = aComms.SendDataToAllClients(data, CGameBTComms::EReliableOrdered, 0);
+        if (error == KErrOverflow)
+        {
+            overflows += 1;
+            HostSpin(0);
+            aComms.Pump();
+            continue;
+        }
+        User::LeaveIfError(error);
+        sent += 1;
+    }
+
+    aComms.Flush();
+    HostSpin(20000);
+
+    return overflows;
+}
+
+static void MainL()
+{
+    THostNotify   notify;
+    CGameBTComms *comms;
+    TPtr8         tooBig(message, sizeof(message), sizeof(message));
+    TInt          allocs;
+    TInt          overflows;
+    TInt          frames;
+    FILE         *log;
+
+    remove(LOG);
+    memset(message, 0x5a, sizeof(message));
+
+    HostWriteIni("[Memory]\nStatic=1\nReassemblySize=512\n");
+
+    comms = HostStartL(notify);
+    CleanupStack::PushL(comms);
+
+    allocs = HostHeap::Allocs();
+
+    /* Device to hub, with the queue full and a message too big */
+    overflows = SendMessagesL(*comms);
+    frames    = HostLink::Stats().iFrames;
+    if (comms->SendDataToAllClients(tooBig) != KErrTooBig)
+    {
+        User::Leave(KErrGeneral);
+    }
+
+    /* Hub to device: whole, fragmented, too big to reassemble, and a
+     * continuation that overruns the announced length */
+    SendFrame(0, message, 24);
+    SendFragmented(KReassemblySize);
+    SendFragmented(KReassemblySize + 1);
+    SendFirst(KFragment + 10);
+    SendFrame(CGameBTComms::KFragmentNext, message, KFragment);
+    SendFrame(0, message, 24);
+    HostSpin(20000);
+    comms->Pump();
+
+    allocs = HostHeap::Allocs() - allocs;
+    log    = fopen(LOG, "r");
+
+    printf("%d messages sent, %d frames at the hub, %d times the queue was full\n", KMessages, frames, overflows);
+    printf("3 messages from the hub, %d received; %d cells allocated, log file %s\n",
+           notify.iReceived, allocs, log ? "written" : "not written");
+
+    CleanupStack::PopAndDestroy(comms);
+
+    if (log)
+    {
+        fclose(log);
+    }
+
+    if ((frames < KMessages) || (overflows == 0) || (notify.iReceived != 3) || (allocs != 0) || log)
+    {
+        User::Leave(KErrGeneral);
+    }
+}
+
+int main()
+{
+    return HostMain(MainL);
+}
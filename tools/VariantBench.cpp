@@ -0,0 +1,219 @@
+/** @file VariantBench.cpp
+ *
+ *  API and speed of one implementation version, built once for each
+ *  API the sources know (see "Versions" in README.md).
+ *
+ *  Every function the DLL of the version exports is called, so a
+ *  declared but undefined one fails the link of this tool, and the
+ *  hub must receive what the send functions sent.  Sending and an
+ *  idle Pump() are then timed.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "HostLink.h"
+#include "HostSession.h"
+
+enum
+{
+    KMessages = 200000, ///< Messages timed per function
+    KChecked  = 1000,   ///< Messages the hub decodes and counts first
+    KPumps    = 1000000 ///< Idle pumps timed
+};
+
+static const TInt KSize = 32; ///< Payload size of the timed messages
+
+static double Seconds(clock_t aStart)
+{
+    return (double)(clock() - aStart) / CLOCKS_PER_SEC;
+}
+
+/* Lets the transmit slots drain and the pump send what is queued */
+static void Settle(CGameBTComms &aComms)
+{
+    aComms.Flush();
+    for (TInt round = 0; round < 16; round += 1)
+    {
+        CActiveScheduler::RunReady();
+        aComms.Pump();
+    }
+}
+
+/* Sends aCount messages with function aFunction, 0 to 2 for
+ * SendDataToAllClients(), SendDataToClient() and SendData() */
+static double SendL(CGameBTComms &aComms, TInt aFunction, TInt aCount)
+{
+    TUint8  payload[KSize];
+    TPtr8   data(payload, KSize, KSize);
+    clock_t start = clock();
+
+    memset(payload, 0x5a, sizeof(payload));
+
+    for (TInt sent = 0; sent < aCount;)
+    {
+        TInt error = KErrNone;
+
+        payload[0] = (TUint8)sent;
+
+        switch (aFunction)
+        {
+            case 0:
+                error = aComms.SendDataToAllClients(data);
+                break;
+            case 1:
+                error = aComms.SendDataToClient(1, data);
+                break;
+#if VERSION >= 10
+            default:
+            {
+                /* No error code, a full queue only shows in its status */
+                CGameBTComms::TQueueStatus status;
+
+                aComms.GetQueueStatus(CGameBTComms::EToClient1, status);
+                if (status.iFreeBytes < KSize + 8)
+                {
+                    error = KErrOverflow;
+                    break;
+                }
+                aComms.SendData(1, data);
+                break;
+            }
+#endif /* VERSION >= 10 */
+        }
+
+        if (error == KErrOverflow)
+        {
+            CActiveScheduler::RunReady();
+            aComms.Pump();
+            continue;
+        }
+        User::LeaveIfError(error);
+        sent += 1;
+    }
+
+    Settle(aComms);
+
+    return Seconds(start);
+}
+
+/* Calls the functions of the version that are not timed */
+static TInt CallApiL(CGameBTComms &aComms)
+{
+    THostName name;
+    TInt      failures = 0;
+
+#if VERSION >= 10
+    THostName rename;
+
+    rename.Copy("variant");
+    aComms.SetLocalDeviceName(rename);
+    failures += (aComms.Connect() != KErrNone);
+    failures += (aComms.SetBluetoothPowerState(ETrue) != KErrNone);
+    failures += (aComms.DeclareRemoteDevice(*(const TDeviceDetails *)&name) != KErrNone);
+    aComms.BluetoothPowerState(ETrue);
+    aComms.SetDiscoverabilityModeLimited(EFalse);
+    aComms.SetHostAcceptMode(CGameBTComms::EConfirmClients);
+    aComms.SetSearchModeLimited(EFalse);
+#endif /* VERSION >= 10 */
+
+    failures += (aComms.GetLocalDeviceName(name) != KErrNone);
+#if VERSION >= 10
+    failures += (name.Length() != rename.Length());
+#endif /* VERSION >= 10 */
+
+    failures += (aComms.ConnectionRole() != CGameBTComms::EHost);
+    failures += (aComms.GameState() != CGameBTComms::EPlay);
+    failures += (aComms.IsShowingDeviceSelectDlg() != EFalse);
+    failures += (aComms.PauseMultiPlayerGame() != KErrNone);
+    failures += (aComms.ContinueMultiPlayerGame() != KErrNone);
+    failures += (aComms.ReconnectL(EFalse) != KErrNone);
+    failures += (aComms.DisconnectClient(1) != KErrNone);
+
+    return failures;
+}
+
+/* Ends the session with the functions of the version */
+static void EndL(CGameBTComms &aComms)
+{
+    TBuf8<8> data;
+
+    /* The role is host, to the host is only decoded by the hub */
+    data.Copy((const TUint8 *)"END", 3);
+    User::LeaveIfError(aComms.SendDataToHost(data));
+
+    aComms.ConnectState();
+    User::LeaveIfError(aComms.EndMultiPlayerGame());
+#if VERSION >= 10
+    aComms.EndSession();
+    aComms.Disconnect(1, EFalse);
+#else
+    aComms.Disconnect();
+#endif /* VERSION >= 10 */
+}
+
+static void MainL()
+{
+    static const char *const KFunctions[] = { "SendDataToAllClients", "SendDataToClient", "SendData" };
+
+    THostNotify   notify;
+    CGameBTComms *comms;
+    TInt          failures;
+    TInt          functions = (VERSION >= 10) ? 3 : 2;
+    clock_t       start;
+    double        pump;
+
+    HostWriteIni("");
+
+    comms = HostStartL(notify);
+    CleanupStack::PushL(comms);
+
+    failures = CallApiL(*comms);
+
+    for (TInt function = 0; function < functions; function += 1)
+    {
+        TInt   frames;
+        double time;
+
+        HostLink::ResetStats();
+        SendL(*comms, function, KChecked);
+        frames = HostLink::Stats().iFrames;
+
+        HostLink::SetDecoding(EFalse);
+        time = SendL(*comms, function, KMessages);
+        HostLink::SetDecoding(ETrue);
+
+        printf("VERSION %2d %-20s %d bytes: %6.1f MB/s payload, %5.2f Mframes/s, %d of %d received\n",
+               VERSION, KFunctions[function], KSize, (double)KSize * KMessages / time / 1e6, KMessages / time / 1e6, frames, KChecked);
+
+        failures += (frames != KChecked);
+    }
+
+    start = clock();
+    for (TInt round = 0; round < KPumps; round += 1)
+    {
+        comms->Pump();
+    }
+    pump = Seconds(start);
+
+    printf("VERSION %2d Pump() idle: %.0f ns (host)\n", VERSION, pump / KPumps * 1e9);
+
+    EndL(*comms);
+    CleanupStack::PopAndDestroy(comms);
+
+    if (failures)
+    {
+        printf("VERSION %2d: %d calls failed\n", VERSION, failures);
+        User::Leave(KErrGeneral);
+    }
+}
+
+int main()
+{
+    return HostMain(MainL);
+}
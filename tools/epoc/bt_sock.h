@@ -0,0 +1,17 @@
+/* Host stand-in, only the types the sources keep as members */
+#ifndef __BT_SOCK_H
+#define __BT_SOCK_H
+
+#include "es_sock.h"
+#include "bttypes.h"
+
+class TBTSockAddr : public TSockAddr
+{
+public:
+    void SetBTAddr(const TBTDevAddr &aAddr) { iAddr = aAddr; }
+
+private:
+    TBTDevAddr iAddr;
+};
+
+#endif /* __BT_SOCK_H */
@@ -0,0 +1,7 @@
+/* Host stand-in, the device selection dialog is not emulated */
+#ifndef __BTEXTNOTIFIERS_H
+#define __BTEXTNOTIFIERS_H
+
+#include "bttypes.h"
+
+#endif /* __BTEXTNOTIFIERS_H */
@@ -0,0 +1,17 @@
+/* Host stand-in, only the types the sources keep as members */
+#ifndef __BTSDP_H
+#define __BTSDP_H
+
+#include "e32host.h"
+
+class TUUID
+{
+public:
+    TUUID() { memset(iUUID, 0, sizeof(iUUID)); }
+    TUUID(TUint32 aLong) { memset(iUUID, 0, sizeof(iUUID)); memcpy(iUUID, &aLong, sizeof(aLong)); }
+
+private:
+    TUint8 iUUID[16];
+};
+
+#endif /* __BTSDP_H */
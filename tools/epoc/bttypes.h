@@ -0,0 +1,16 @@
+/* Host stand-in, only the types the sources keep as members */
+#ifndef __BTTYPES_H
+#define __BTTYPES_H
+
+#include "e32host.h"
+
+class TBTDevAddr
+{
+public:
+    TBTDevAddr() { memset(iAddr, 0, sizeof(iAddr)); }
+
+private:
+    TUint8 iAddr[6];
+};
+
+#endif /* __BTTYPES_H */
@@ -0,0 +1,2 @@
+/* Host stand-in, see e32host.h */
+#include "e32host.h"
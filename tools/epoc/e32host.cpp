@@ -0,0 +1,790 @@
+/** @file e32host.cpp
+ *
+ *  Host stand-in for the parts of the Symbian OS 6.1 user library the
+ *  GameComms sources use, see e32host.h.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "e32host.h"
+
+enum
+{
+    KCleanupDepth = 64 ///< Items the cleanup stack holds
+};
+
+typedef struct
+{
+    TAny  *iPtr;
+    TBool  iObject; ///< ETrue if iPtr is a CBase to delete, otherwise a cell to free
+} TCleanupItem;
+
+static TCleanupItem      cleanupStack[KCleanupDepth];
+static TInt              cleanupDepth;
+static CActive          *activeObjects;
+static CActiveScheduler *installedScheduler;
+static TInt              heapAllocs;
+static TInt              heapCells;
+
+static void HostPanic(const char *aCategory, TInt aReason)
+{
+    fprintf(stderr, "Panic %s %d\n", aCategory, aReason);
+    abort();
+}
+
+/* ------------------------------------------------------------------ */
+
+void TTime::HomeTime()
+{
+    struct timeval     now;
+    unsigned long long micros;
+
+    gettimeofday(&now, NULL);
+    micros = (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+    iTime  = TInt64((TUint)(micros >> 32), (TUint)micros);
+}
+
+/* ------------------------------------------------------------------ */
+
+const TUint8 &TDesC8::operator[](TInt aIndex) const
+{
+    if ((aIndex < 0) || (aIndex >= Length()))
+    {
+        HostPanic("USER", 21);
+    }
+
+    return iPtr[aIndex];
+}
+
+TPtrC8 TDesC8::Left(TInt aLength) const
+{
+    return TPtrC8(iPtr, Min(aLength, Length()));
+}
+
+TPtrC8 TDesC8::Right(TInt aLength) const
+{
+    aLength = Min(aLength, Length());
+
+    return TPtrC8(iPtr + Length() - aLength, aLength);
+}
+
+TPtrC8 TDesC8::Mid(TInt aPos) const
+{
+    if ((aPos < 0) || (aPos > Length()))
+    {
+        HostPanic("USER", 10);
+    }
+
+    return TPtrC8(iPtr + aPos, Length() - aPos);
+}
+
+TPtrC8 TDesC8::Mid(TInt aPos, TInt aLength) const
+{
+    if ((aPos < 0) || (aLength < 0) || (aPos + aLength > Length()))
+    {
+        HostPanic("USER", 10);
+    }
+
+    return TPtrC8(iPtr + aPos, aLength);
+}
+
+TInt TDesC8::Compare(const TDesC8 &aDes) const
+{
+    return Mem::Compare(iPtr, Length(), aDes.Ptr(), aDes.Length());
+}
+
+TInt TDesC8::Find(const TDesC8 &aDes) const
+{
+    for (TInt pos = 0; pos + aDes.Length() <= Length(); pos += 1)
+    {
+        if (memcmp(iPtr + pos, aDes.Ptr(), aDes.Length()) == 0)
+        {
+            return pos;
+        }
+    }
+
+    return KErrNotFound;
+}
+
+TInt TDesC8::Locate(TChar aChar) const
+{
+    for (TInt pos = 0; pos < Length(); pos += 1)
+    {
+        if (iPtr[pos] == aChar)
+        {
+            return pos;
+        }
+    }
+
+    return KErrNotFound;
+}
+
+HBufC8 *TDesC8::AllocL() const
+{
+    HBufC8 *copy = HBufC8::NewL(Length());
+
+    copy->Des().Copy(*this);
+
+    return copy;
+}
+
+TDes8::TDes8(TUint8 *aPtr, TInt aLength, TInt aMaxLength)
+: TDesC8(aPtr, aLength),
+  iMaxLength(aMaxLength)
+{
+    if ((aLength < 0) || (aLength > aMaxLength))
+    {
+        HostPanic("USER", 11);
+    }
+}
+
+void TDes8::SetLength(TInt aLength)
+{
+    if ((aLength < 0) || (aLength > iMaxLength))
+    {
+        HostPanic("USER", 11);
+    }
+
+    *iLen = aLength;
+}
+
+void TDes8::Copy(const TUint8 *aBuf, TInt aLength)
+{
+    SetLength(aLength);
+    memmove(iPtr, aBuf, aLength);
+}
+
+void TDes8::Copy(const TDesC16 &aDes)
+{
+    SetLength(aDes.Length());
+    for (TInt index = 0; index < aDes.Length(); index += 1)
+    {
+        iPtr[index] = (TUint8)aDes[index];
+    }
+}
+
+void TDes8::Append(const TUint8 *aBuf, TInt aLength)
+{
+    TInt length = Length();
+
+    SetLength(length + aLength);
+    memmove(iPtr + length, aBuf, aLength);
+}
+
+void TDes8::Delete(TInt aPos, TInt aLength)
+{
+    if ((aPos < 0) || (aPos > Length()))
+    {
+        HostPanic("USER", 10);
+    }
+
+    aLength = Min(aLength, Length() - aPos);
+    memmove(iPtr + aPos, iPtr + aPos + aLength, Length() - aPos - aLength);
+    SetLength(Length() - aLength);
+}
+
+void TDes8::Insert(TInt aPos, const TDesC8 &aDes)
+{
+    TInt length = Length();
+
+    if ((aPos < 0) || (aPos > length))
+    {
+        HostPanic("USER", 10);
+    }
+
+    SetLength(length + aDes.Length());
+    memmove(iPtr + aPos + aDes.Length(), iPtr + aPos, length - aPos);
+    memmove(iPtr + aPos, aDes.Ptr(), aDes.Length());
+}
+
+TUint8 &TDes8::operator[](TInt aIndex)
+{
+    if ((aIndex < 0) || (aIndex >= Length()))
+    {
+        HostPanic("USER", 21);
+    }
+
+    return iPtr[aIndex];
+}
+
+TPtrC8::TPtrC8(const TUint8 *aBuf, TInt aLength)
+: TDesC8(aBuf, aLength)
+{
+    if (aLength < 0)
+    {
+        HostPanic("USER", 17);
+    }
+}
+
+TPtr8::TPtr8(const TPtr8 &aPtr)
+: TDes8(aPtr)
+{
+    /* A copy of HBufC8::Des() still changes the heap descriptor. */
+    if (aPtr.iLen != &aPtr.iLength)
+    {
+        iLen = aPtr.iLen;
+    }
+}
+
+TPtr8::TPtr8(TUint8 *aBuf, TInt *aLength, TInt aMaxLength)
+: TDes8(aBuf, *aLength, aMaxLength)
+{
+    iLen = aLength;
+}
+
+void TPtr8::Set(TUint8 *aBuf, TInt aLength, TInt aMaxLength)
+{
+    Bind(aBuf, aLength);
+    iMaxLength = aMaxLength;
+    SetLength(aLength);
+}
+
+HBufC8::HBufC8(TInt aMaxLength)
+: TDesC8((TUint8 *)(this + 1), 0),
+  iMaxLength(aMaxLength)
+{
+}
+
+HBufC8 *HBufC8::New(TInt aMaxLength)
+{
+    TAny *cell = User::Alloc(sizeof(HBufC8) + aMaxLength);
+
+    if (! cell)
+    {
+        return NULL;
+    }
+
+    return new (cell) HBufC8(aMaxLength);
+}
+
+HBufC8 *HBufC8::NewL(TInt aMaxLength)
+{
+    return (HBufC8 *)User::LeaveIfNull(New(aMaxLength));
+}
+
+HBufC8 *HBufC8::NewLC(TInt aMaxLength)
+{
+    HBufC8 *buffer = NewL(aMaxLength);
+
+    CleanupStack::PushL(buffer);
+
+    return buffer;
+}
+
+void HBufC8::operator delete(TAny *aPtr)
+{
+    User::Free(aPtr);
+}
+
+void HBufC8::operator delete(TAny *aPtr, TAny *aCell)
+{
+    (void)aCell;
+    User::Free(aPtr);
+}
+
+void TDes16::SetLength(TInt aLength)
+{
+    if ((aLength < 0) || (aLength > iMaxLength))
+    {
+        HostPanic("USER", 11);
+    }
+
+    iLength = aLength;
+}
+
+void TDes16::Copy(const TDesC8 &aDes)
+{
+    SetLength(aDes.Length());
+    for (TInt index = 0; index < aDes.Length(); index += 1)
+    {
+        iPtr[index] = aDes.Ptr()[index];
+    }
+}
+
+void TDes16::Copy(const TDesC16 &aDes)
+{
+    SetLength(aDes.Length());
+    memmove(iPtr, aDes.Ptr(), aDes.Length() * sizeof(TUint16));
+}
+
+void TDes16::Copy(const char *aString)
+{
+    SetLength((TInt)strlen(aString));
+    for (TInt index = 0; index < iLength; index += 1)
+    {
+        iPtr[index] = (TUint8)aString[index];
+    }
+}
+
+/* ------------------------------------------------------------------ */
+
+void User::Leave(TInt aReason)
+{
+    throw THostLeave(aReason);
+}
+
+TInt User::LeaveIfError(TInt aReason)
+{
+    if (aReason < 0)
+    {
+        Leave(aReason);
+    }
+
+    return aReason;
+}
+
+TAny *User::LeaveIfNull(TAny *aPtr)
+{
+    if (! aPtr)
+    {
+        Leave(KErrNoMemory);
+    }
+
+    return aPtr;
+}
+
+void User::LeaveNoMemory()
+{
+    Leave(KErrNoMemory);
+}
+
+void User::Panic(const TDesC16 &aCategory, TInt aReason)
+{
+    char category[KMaxName + 1];
+    TInt length = Min(aCategory.Length(), (TInt)KMaxName);
+
+    for (TInt index = 0; index < length; index += 1)
+    {
+        category[index] = (char)aCategory[index];
+    }
+    category[length] = '\0';
+
+    HostPanic(category, aReason);
+}
+
+TAny *User::Alloc(TInt aSize)
+{
+    TAny *cell = malloc(aSize);
+
+    if (cell)
+    {
+        heapAllocs += 1;
+        heapCells  += 1;
+    }
+
+    return cell;
+}
+
+TAny *User::AllocL(TInt aSize)
+{
+    return LeaveIfNull(Alloc(aSize));
+}
+
+TAny *User::AllocLC(TInt aSize)
+{
+    TAny *cell = AllocL(aSize);
+
+    CleanupStack::PushL(cell);
+
+    return cell;
+}
+
+TAny *User::AllocZ(TInt aSize)
+{
+    TAny *cell = Alloc(aSize);
+
+    if (cell)
+    {
+        memset(cell, 0, aSize);
+    }
+
+    return cell;
+}
+
+TAny *User::AllocZL(TInt aSize)
+{
+    return LeaveIfNull(AllocZ(aSize));
+}
+
+void User::Free(TAny *aCell)
+{
+    if (aCell)
+    {
+        heapCells -= 1;
+        free(aCell);
+    }
+}
+
+void User::After(TTimeIntervalMicroSeconds32 aInterval)
+{
+    usleep(aInterval.Int());
+}
+
+void User::RequestComplete(TRequestStatus *&aStatus, TInt aReason)
+{
+    *aStatus = aReason;
+    aStatus  = NULL;
+}
+
+TUint User::TickCount()
+{
+    TTime now;
+
+    now.HomeTime();
+
+    return (now.Int64() / TInt64(15625)).Low();
+}
+
+TInt Mem::Compare(const TUint8 *aLeft, TInt aLeftL, const TUint8 *aRight, TInt aRightL)
+{
+    TInt result = memcmp(aLeft, aRight, Min(aLeftL, aRightL));
+
+    return (result != 0) ? result : (aLeftL - aRightL);
+}
+
+THostTrap::THostTrap()
+: iMark(cleanupDepth)
+{
+}
+
+TInt THostTrap::Unwind(TInt aReason)
+{
+    CleanupStack::PopAndDestroy(cleanupDepth - iMark);
+
+    return aReason;
+}
+
+TInt HostHeap::Allocs()
+{
+    return heapAllocs;
+}
+
+TInt HostHeap::Cells()
+{
+    return heapCells;
+}
+
+/* ------------------------------------------------------------------ */
+
+CBase::CBase()
+{
+}
+
+CBase::~CBase()
+{
+}
+
+TAny *CBase::operator new(size_t aSize)
+{
+    return User::AllocZ((TInt)aSize);
+}
+
+TAny *CBase::operator new(size_t aSize, TLeave)
+{
+    return User::AllocZL((TInt)aSize);
+}
+
+void CBase::operator delete(TAny *aPtr)
+{
+    User::Free(aPtr);
+}
+
+void CBase::operator delete(TAny *aPtr, TLeave)
+{
+    User::Free(aPtr);
+}
+
+static void Push(TAny *aPtr, TBool aObject)
+{
+    if (cleanupDepth == KCleanupDepth)
+    {
+        HostPanic("E32USER-CBase", 66);
+    }
+
+    cleanupStack[cleanupDepth].iPtr    = aPtr;
+    cleanupStack[cleanupDepth].iObject = aObject;
+    cleanupDepth += 1;
+}
+
+void CleanupStack::PushL(TAny *aPtr)
+{
+    Push(aPtr, EFalse);
+}
+
+void CleanupStack::PushL(CBase *aPtr)
+{
+    Push(aPtr, ETrue);
+}
+
+void CleanupStack::Pop()
+{
+    Pop(1);
+}
+
+void CleanupStack::Pop(TInt aCount)
+{
+    if (aCount > cleanupDepth)
+    {
+        HostPanic("E32USER-CBase", 63);
+    }
+
+    cleanupDepth -= aCount;
+}
+
+void CleanupStack::Pop(TAny *aExpectedItem)
+{
+    if ((cleanupDepth == 0) || (cleanupStack[cleanupDepth - 1].iPtr != aExpectedItem))
+    {
+        HostPanic("E32USER-CBase", 90);
+    }
+
+    Pop(1);
+}
+
+void CleanupStack::PopAndDestroy()
+{
+    PopAndDestroy(1);
+}
+
+void CleanupStack::PopAndDestroy(TInt aCount)
+{
+    if (aCount > cleanupDepth)
+    {
+        HostPanic("E32USER-CBase", 63);
+    }
+
+    while (aCount > 0)
+    {
+        TCleanupItem item = cleanupStack[--cleanupDepth];
+
+        if (item.iObject)
+        {
+            delete (CBase *)item.iPtr;
+        }
+        else
+        {
+            User::Free(item.iPtr);
+        }
+        aCount -= 1;
+    }
+}
+
+void CleanupStack::PopAndDestroy(TAny *aExpectedItem)
+{
+    if ((cleanupDepth == 0) || (cleanupStack[cleanupDepth - 1].iPtr != aExpectedItem))
+    {
+        HostPanic("E32USER-CBase", 90);
+    }
+
+    PopAndDestroy(1);
+}
+
+CTrapCleanup *CTrapCleanup::New()
+{
+    return new CTrapCleanup;
+}
+
+/* ------------------------------------------------------------------ */
+
+CActive::CActive(TInt aPriority)
+: iPriority(aPriority)
+{
+}
+
+CActive::~CActive()
+{
+    if (iActive)
+    {
+        HostPanic("E32USER-CBase", 40);
+    }
+
+    Deque();
+}
+
+void CActive::Cancel()
+{
+    if (iActive)
+    {
+        DoCancel();
+        iActive = EFalse;
+        iTiming = EFalse;
+    }
+}
+
+void CActive::Deque()
+{
+    if (iAdded)
+    {
+        Cancel();
+        CActiveScheduler::Remove(this);
+    }
+}
+
+TInt CActive::RunError(TInt aError)
+{
+    return aError;
+}
+
+void CActiveScheduler::Add(CActive *aActive)
+{
+    CActive **link = &activeObjects;
+
+    /* Kept in priority order, the first ready object runs first. */
+    while (*link && ((*link)->iPriority >= aActive->iPriority))
+    {
+        link = &(*link)->iNext;
+    }
+
+    aActive->iNext  = *link;
+    aActive->iAdded = ETrue;
+    *link           = aActive;
+}
+
+void CActiveScheduler::Remove(CActive *aActive)
+{
+    for (CActive **link = &activeObjects; *link; link = &(*link)->iNext)
+    {
+        if (*link == aActive)
+        {
+            *link           = aActive->iNext;
+            aActive->iAdded = EFalse;
+            return;
+        }
+    }
+}
+
+void CActiveScheduler::Install(CActiveScheduler *aScheduler)
+{
+    installedScheduler = aScheduler;
+}
+
+CActiveScheduler *CActiveScheduler::Current()
+{
+    return installedScheduler;
+}
+
+void CActiveScheduler::Stop()
+{
+}
+
+TInt CActiveScheduler::RunReady()
+{
+    TInt runs = 0;
+
+    for (;;)
+    {
+        CActive *ready = NULL;
+        TTime    now;
+
+        now.HomeTime();
+
+        for (CActive *active = activeObjects; active; active = active->iNext)
+        {
+            if (active->iActive && active->iTiming && (now >= active->iDue))
+            {
+                active->iTiming = EFalse;
+                active->iStatus = KErrNone;
+            }
+
+            if (! ready && active->iActive && (active->iStatus != KRequestPending))
+            {
+                ready = active;
+            }
+        }
+
+        if (! ready)
+        {
+            return runs;
+        }
+
+        ready->iActive = EFalse;
+        runs += 1;
+
+        TRAPD(error, ready->RunL());
+        if ((error != KErrNone) && (ready->RunError(error) != KErrNone))
+        {
+            HostPanic("E32USER-CBase", 47);
+        }
+    }
+}
+
+CTimer::CTimer(TInt aPriority)
+: CActive(aPriority)
+{
+}
+
+CTimer::~CTimer()
+{
+    Cancel();
+}
+
+void CTimer::ConstructL()
+{
+}
+
+void CTimer::After(TTimeIntervalMicroSeconds32 aInterval)
+{
+    if (IsActive())
+    {
+        HostPanic("E32USER-CBase", 42);
+    }
+
+    iDue.HomeTime();
+    iDue    += aInterval;
+    iTiming  = ETrue;
+    iStatus  = KRequestPending;
+    SetActive();
+}
+
+void CTimer::DoCancel()
+{
+    iTiming = EFalse;
+    iStatus = KErrCancel;
+}
+
+CPeriodic::CPeriodic(TInt aPriority)
+: CTimer(aPriority)
+{
+}
+
+CPeriodic::~CPeriodic()
+{
+    Cancel();
+}
+
+CPeriodic *CPeriodic::New(TInt aPriority)
+{
+    CPeriodic *self = new CPeriodic(aPriority);
+
+    if (self)
+    {
+        CActiveScheduler::Add(self);
+    }
+
+    return self;
+}
+
+CPeriodic *CPeriodic::NewL(TInt aPriority)
+{
+    return (CPeriodic *)User::LeaveIfNull(New(aPriority));
+}
+
+void CPeriodic::Start(TTimeIntervalMicroSeconds32 aDelay, TTimeIntervalMicroSeconds32 aInterval, TCallBack aCallBack)
+{
+    iInterval = aInterval;
+    iCallBack = aCallBack;
+    After(aDelay);
+}
+
+void CPeriodic::RunL()
+{
+    After(iInterval);
+    iCallBack.CallBack();
+}
@@ -0,0 +1,609 @@
+/** @file e32host.h
+ *
+ *  Host stand-in for the parts of the Symbian OS 6.1 user library the
+ *  GameComms sources use, so that they can be compiled and run by the
+ *  host tools.  Only what the sources need is provided.  Panics and
+ *  descriptor overflows abort the tool.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __E32HOST_H
+#define __E32HOST_H
+
+#include <stddef.h>
+#include <string.h>
+
+typedef signed char    TInt8;
+typedef unsigned char  TUint8;
+typedef short int      TInt16;
+typedef unsigned short TUint16;
+typedef int            TInt32;
+typedef unsigned int   TUint32;
+typedef int            TInt;
+typedef unsigned int   TUint;
+typedef int            TBool;
+typedef void           TAny;
+typedef unsigned char  TText8;
+typedef unsigned short TText16;
+typedef TText16        TText;
+typedef unsigned int   TChar;
+typedef double         TReal;
+
+enum TFalse { EFalse = 0 };
+enum TTrue  { ETrue  = 1 };
+
+#define IMPORT_C
+#define EXPORT_C
+#define GLDEF_C
+#define GLREF_C extern
+#define LOCAL_C static
+#define LOCAL_D static
+
+#define __ASSERT_ALWAYS(c, p) do { if (! (c)) { p; } } while (0)
+#define __ASSERT_DEBUG(c, p)  __ASSERT_ALWAYS(c, p)
+
+const TInt KMaxTInt    = 0x7fffffff;
+const TInt KMaxTInt16  = 0x7fff;
+const TInt KMaxTUint8  = 0xff;
+const TInt KMaxTUint16 = 0xffff;
+const TInt KMaxName    = 0x80;
+
+const TInt KErrNone          = 0;
+const TInt KErrNotFound      = -1;
+const TInt KErrGeneral       = -2;
+const TInt KErrCancel        = -3;
+const TInt KErrNoMemory      = -4;
+const TInt KErrNotSupported  = -5;
+const TInt KErrArgument      = -6;
+const TInt KErrOverflow      = -9;
+const TInt KErrUnderflow     = -10;
+const TInt KErrAlreadyExists = -11;
+const TInt KErrInUse         = -14;
+const TInt KErrNotReady      = -18;
+const TInt KErrCorrupt       = -20;
+const TInt KErrEof           = -25;
+const TInt KErrTimedOut      = -33;
+const TInt KErrDisconnected  = -36;
+const TInt KErrTooBig        = -40;
+const TInt KRequestPending   = -KMaxTInt;
+
+enum TDllReason { EDllProcessAttach, EDllThreadAttach, EDllThreadDetach, EDllProcessDetach };
+enum TLeave { ELeave };
+
+template <class T> inline T Min(T aLeft, T aRight) { return (aLeft < aRight) ? aLeft : aRight; }
+template <class T> inline T Max(T aLeft, T aRight) { return (aLeft > aRight) ? aLeft : aRight; }
+template <class T> inline T Abs(T aValue) { return (aValue < 0) ? -aValue : aValue; }
+
+/* ------------------------------------------------------------------ */
+/* Time                                                               */
+/* ------------------------------------------------------------------ */
+
+class TInt64
+{
+public:
+    TInt64() : iValue(0) {}
+    TInt64(TInt aValue) : iValue(aValue) {}
+    TInt64(TUint aHigh, TUint aLow) : iValue((long long)(((unsigned long long)aHigh << 32) | aLow)) {}
+    TUint Low() const { return (TUint)(iValue & 0xffffffffu); }
+    TUint High() const { return (TUint)((unsigned long long)iValue >> 32); }
+    TInt GetTInt() const { return (TInt)iValue; }
+    TInt64 operator-() const { return Make(-iValue); }
+    TInt64 operator+(const TInt64 &aValue) const { return Make(iValue + aValue.iValue); }
+    TInt64 operator-(const TInt64 &aValue) const { return Make(iValue - aValue.iValue); }
+    TInt64 operator*(const TInt64 &aValue) const { return Make(iValue * aValue.iValue); }
+    TInt64 operator/(const TInt64 &aValue) const { return Make(iValue / aValue.iValue); }
+    TInt64 &operator+=(const TInt64 &aValue) { iValue += aValue.iValue; return *this; }
+    TInt64 &operator-=(const TInt64 &aValue) { iValue -= aValue.iValue; return *this; }
+    TBool operator==(const TInt64 &aValue) const { return iValue == aValue.iValue; }
+    TBool operator!=(const TInt64 &aValue) const { return iValue != aValue.iValue; }
+    TBool operator<(const TInt64 &aValue) const { return iValue < aValue.iValue; }
+    TBool operator>(const TInt64 &aValue) const { return iValue > aValue.iValue; }
+    TBool operator<=(const TInt64 &aValue) const { return iValue <= aValue.iValue; }
+    TBool operator>=(const TInt64 &aValue) const { return iValue >= aValue.iValue; }
+
+private:
+    static TInt64 Make(long long aValue) { TInt64 value; value.iValue = aValue; return value; }
+    long long iValue;
+};
+
+class TTimeIntervalMicroSeconds32
+{
+public:
+    TTimeIntervalMicroSeconds32() : iInterval(0) {}
+    TTimeIntervalMicroSeconds32(TInt aInterval) : iInterval(aInterval) {}
+    TInt Int() const { return iInterval; }
+
+private:
+    TInt iInterval;
+};
+
+class TTimeIntervalMicroSeconds
+{
+public:
+    TTimeIntervalMicroSeconds() {}
+    TTimeIntervalMicroSeconds(const TInt64 &aInterval) : iInterval(aInterval) {}
+    const TInt64 &Int64() const { return iInterval; }
+
+private:
+    TInt64 iInterval;
+};
+
+class TTime
+{
+public:
+    TTime() {}
+    TTime(const TInt64 &aTime) : iTime(aTime) {}
+    TTime &operator=(const TInt64 &aTime) { iTime = aTime; return *this; }
+    void HomeTime();
+    void UniversalTime() { HomeTime(); }
+    const TInt64 &Int64() const { return iTime; }
+    TTimeIntervalMicroSeconds MicroSecondsFrom(TTime aTime) const { return TTimeIntervalMicroSeconds(iTime - aTime.iTime); }
+    TTime operator+(TTimeIntervalMicroSeconds32 aInterval) const { return TTime(iTime + TInt64(aInterval.Int())); }
+    TTime &operator+=(TTimeIntervalMicroSeconds32 aInterval) { iTime += TInt64(aInterval.Int()); return *this; }
+    TBool operator==(TTime aTime) const { return iTime == aTime.iTime; }
+    TBool operator<(TTime aTime) const { return iTime < aTime.iTime; }
+    TBool operator>(TTime aTime) const { return iTime > aTime.iTime; }
+    TBool operator<=(TTime aTime) const { return iTime <= aTime.iTime; }
+    TBool operator>=(TTime aTime) const { return iTime >= aTime.iTime; }
+
+private:
+    TInt64 iTime;
+};
+
+/* ------------------------------------------------------------------ */
+/* Descriptors                                                        */
+/* ------------------------------------------------------------------ */
+
+class TPtrC8;
+class TPtr8;
+class HBufC8;
+class TDesC16;
+
+/* Every descriptor reads its length through iLen, which points to its
+ * own iLength except for the TPtr8 returned by HBufC8::Des(), which
+ * changes the length of the heap descriptor. */
+class TDesC8
+{
+public:
+    TInt Length() const { return *iLen; }
+    TInt Size() const { return *iLen; }
+    const TUint8 *Ptr() const { return iPtr; }
+    const TUint8 &operator[](TInt aIndex) const;
+    TPtrC8 Left(TInt aLength) const;
+    TPtrC8 Right(TInt aLength) const;
+    TPtrC8 Mid(TInt aPos) const;
+    TPtrC8 Mid(TInt aPos, TInt aLength) const;
+    TInt Compare(const TDesC8 &aDes) const;
+    TInt Find(const TDesC8 &aDes) const;
+    TInt Locate(TChar aChar) const;
+    HBufC8 *AllocL() const;
+    TBool operator==(const TDesC8 &aDes) const { return Compare(aDes) == 0; }
+    TBool operator!=(const TDesC8 &aDes) const { return Compare(aDes) != 0; }
+
+protected:
+    TDesC8(const TUint8 *aPtr, TInt aLength) : iPtr((TUint8 *)aPtr), iLength(aLength), iLen(&iLength) {}
+    TDesC8(const TDesC8 &aDes) : iPtr(aDes.iPtr), iLength(aDes.Length()), iLen(&iLength) {}
+    void Bind(const TUint8 *aPtr, TInt aLength) { iPtr = (TUint8 *)aPtr; iLength = aLength; iLen = &iLength; }
+
+    TUint8 *iPtr;
+    TInt    iLength;
+    TInt   *iLen;
+
+private:
+    TDesC8 &operator=(const TDesC8 &aDes);
+};
+
+class TDes8 : public TDesC8
+{
+public:
+    TInt MaxLength() const { return iMaxLength; }
+    void SetLength(TInt aLength);
+    void SetMax() { SetLength(iMaxLength); }
+    void Zero() { SetLength(0); }
+    void FillZ() { memset(iPtr, 0, Length()); }
+    void FillZ(TInt aLength) { SetLength(aLength); FillZ(); }
+    void Copy(const TDesC8 &aDes) { Copy(aDes.Ptr(), aDes.Length()); }
+    void Copy(const TUint8 *aBuf, TInt aLength);
+    void Copy(const TDesC16 &aDes);
+    void Append(const TDesC8 &aDes) { Append(aDes.Ptr(), aDes.Length()); }
+    void Append(const TUint8 *aBuf, TInt aLength);
+    void Append(TChar aChar) { TUint8 byte = (TUint8)aChar; Append(&byte, 1); }
+    void Delete(TInt aPos, TInt aLength);
+    void Insert(TInt aPos, const TDesC8 &aDes);
+    TUint8 &operator[](TInt aIndex);
+    const TUint8 &operator[](TInt aIndex) const { return TDesC8::operator[](aIndex); }
+    TDes8 &operator=(const TDesC8 &aDes) { Copy(aDes); return *this; }
+    TDes8 &operator=(const TDes8 &aDes) { Copy(aDes); return *this; }
+
+protected:
+    TDes8(TUint8 *aPtr, TInt aLength, TInt aMaxLength);
+    TDes8(const TDes8 &aDes) : TDesC8(aDes), iMaxLength(aDes.iMaxLength) {}
+
+    TInt iMaxLength;
+};
+
+class TPtrC8 : public TDesC8
+{
+public:
+    TPtrC8() : TDesC8(NULL, 0) {}
+    TPtrC8(const TDesC8 &aDes) : TDesC8(aDes.Ptr(), aDes.Length()) {}
+    TPtrC8(const TPtrC8 &aDes) : TDesC8(aDes.Ptr(), aDes.Length()) {}
+    TPtrC8(const TUint8 *aString) : TDesC8(aString, (TInt)strlen((const char *)aString)) {}
+    TPtrC8(const TUint8 *aBuf, TInt aLength);
+    void Set(const TDesC8 &aDes) { Bind(aDes.Ptr(), aDes.Length()); }
+    void Set(const TPtrC8 &aDes) { Bind(aDes.Ptr(), aDes.Length()); }
+    void Set(const TUint8 *aBuf, TInt aLength) { Bind(aBuf, aLength); }
+    TPtrC8 &operator=(const TPtrC8 &aDes) { Set(aDes); return *this; }
+};
+
+class TPtr8 : public TDes8
+{
+public:
+    TPtr8(TUint8 *aBuf, TInt aMaxLength) : TDes8(aBuf, 0, aMaxLength) {}
+    TPtr8(TUint8 *aBuf, TInt aLength, TInt aMaxLength) : TDes8(aBuf, aLength, aMaxLength) {}
+    TPtr8(const TPtr8 &aPtr);
+    void Set(TUint8 *aBuf, TInt aLength, TInt aMaxLength);
+    void Set(const TPtr8 &aPtr) { Set(aPtr.iPtr, aPtr.Length(), aPtr.iMaxLength); }
+    TPtr8 &operator=(const TDesC8 &aDes) { Copy(aDes); return *this; }
+    TPtr8 &operator=(const TPtr8 &aDes) { Copy(aDes); return *this; }
+
+private:
+    friend class HBufC8;
+    TPtr8(TUint8 *aBuf, TInt *aLength, TInt aMaxLength);
+};
+
+template <TInt S> class TBuf8 : public TDes8
+{
+public:
+    TBuf8() : TDes8(iBuf, 0, S) {}
+    explicit TBuf8(TInt aLength) : TDes8(iBuf, aLength, S) {}
+    TBuf8(const TDesC8 &aDes) : TDes8(iBuf, 0, S) { Copy(aDes); }
+    TBuf8(const TBuf8<S> &aBuf) : TDes8(iBuf, 0, S) { Copy(aBuf); }
+    TBuf8<S> &operator=(const TDesC8 &aDes) { Copy(aDes); return *this; }
+    TBuf8<S> &operator=(const TBuf8<S> &aBuf) { Copy(aBuf); return *this; }
+
+private:
+    TUint8 iBuf[S];
+};
+
+/* The data follows the object in the same heap cell. */
+class HBufC8 : public TDesC8
+{
+public:
+    static HBufC8 *New(TInt aMaxLength);
+    static HBufC8 *NewL(TInt aMaxLength);
+    static HBufC8 *NewLC(TInt aMaxLength);
+    TPtr8 Des() { return TPtr8(iPtr, &iLength, iMaxLength); }
+    static void operator delete(TAny *aPtr);
+
+private:
+    HBufC8(TInt aMaxLength);
+    static TAny *operator new(size_t aSize, TAny *aCell) { (void)aSize; return aCell; }
+    static void operator delete(TAny *aPtr, TAny *aCell);
+
+    TInt iMaxLength;
+};
+
+/* 16 bit descriptors only serve names, e.g. panic categories. */
+class TDesC16
+{
+public:
+    TInt Length() const { return iLength; }
+    const TUint16 *Ptr() const { return iPtr; }
+    const TUint16 &operator[](TInt aIndex) const { return iPtr[aIndex]; }
+
+protected:
+    TDesC16(const TUint16 *aPtr, TInt aLength) : iPtr((TUint16 *)aPtr), iLength(aLength) {}
+
+    TUint16 *iPtr;
+    TInt     iLength;
+
+private:
+    TDesC16(const TDesC16 &aDes);
+    TDesC16 &operator=(const TDesC16 &aDes);
+};
+
+class TDes16 : public TDesC16
+{
+public:
+    TInt MaxLength() const { return iMaxLength; }
+    void SetLength(TInt aLength);
+    void Zero() { SetLength(0); }
+    void Copy(const TDesC8 &aDes);
+    void Copy(const TDesC16 &aDes);
+    void Copy(const char *aString);
+
+protected:
+    TDes16(TUint16 *aPtr, TInt aMaxLength) : TDesC16(aPtr, 0), iMaxLength(aMaxLength) {}
+
+    TInt iMaxLength;
+};
+
+template <TInt S> class TBuf16 : public TDes16
+{
+public:
+    TBuf16() : TDes16(iBuf, S) {}
+    TBuf16(const char *aString) : TDes16(iBuf, S) { Copy(aString); }
+    TBuf16(const TDesC16 &aDes) : TDes16(iBuf, S) { Copy(aDes); }
+    TBuf16(const TBuf16<S> &aBuf) : TDes16(iBuf, S) { Copy(aBuf); }
+    TBuf16<S> &operator=(const TDesC16 &aDes) { Copy(aDes); return *this; }
+    TBuf16<S> &operator=(const TBuf16<S> &aBuf) { Copy(aBuf); return *this; }
+
+private:
+    TUint16 iBuf[S];
+};
+
+typedef TDesC16 TDesC;
+typedef TDes16  TDes;
+#define TBuf TBuf16
+
+/* Narrow literals are widened, the host has no 16 bit wchar_t. */
+#define _L(s) TBuf16<KMaxName>(s)
+
+/* ------------------------------------------------------------------ */
+/* User library                                                       */
+/* ------------------------------------------------------------------ */
+
+class TRequestStatus
+{
+public:
+    TRequestStatus() : iStatus(0) {}
+    TRequestStatus(TInt aVal) : iStatus(aVal) {}
+    TRequestStatus &operator=(TInt aVal) { iStatus = aVal; return *this; }
+    TBool operator==(TInt aVal) const { return iStatus == aVal; }
+    TBool operator!=(TInt aVal) const { return iStatus != aVal; }
+    TInt Int() const { return iStatus; }
+
+private:
+    TInt iStatus;
+};
+
+class TCallBack
+{
+public:
+    TCallBack() : iFunction(NULL), iPtr(NULL) {}
+    TCallBack(TInt (*aFunction)(TAny *aPtr)) : iFunction(aFunction), iPtr(NULL) {}
+    TCallBack(TInt (*aFunction)(TAny *aPtr), TAny *aPtr) : iFunction(aFunction), iPtr(aPtr) {}
+    TInt CallBack() const { return iFunction ? iFunction(iPtr) : 0; }
+
+public:
+    TInt (*iFunction)(TAny *aPtr);
+    TAny *iPtr;
+};
+
+/* Threads are not emulated, only the types the sources keep as members. */
+enum TOwnerType { EOwnerProcess, EOwnerThread };
+
+class TThreadId
+{
+public:
+    TThreadId() : iId(0) {}
+
+private:
+    TUint iId;
+};
+
+class RThread
+{
+public:
+    TThreadId Id() const { return TThreadId(); }
+    void Close() {}
+};
+
+class User
+{
+public:
+    static void Leave(TInt aReason);
+    static TInt LeaveIfError(TInt aReason);
+    static TAny *LeaveIfNull(TAny *aPtr);
+    static void LeaveNoMemory();
+    static void Panic(const TDesC16 &aCategory, TInt aReason);
+    static TAny *Alloc(TInt aSize);
+    static TAny *AllocL(TInt aSize);
+    static TAny *AllocLC(TInt aSize);
+    static TAny *AllocZ(TInt aSize);
+    static TAny *AllocZL(TInt aSize);
+    static void Free(TAny *aCell);
+    static void After(TTimeIntervalMicroSeconds32 aInterval);
+    static void RequestComplete(TRequestStatus *&aStatus, TInt aReason);
+    static TUint TickCount();
+    static TInt LockedInc(TInt &aValue) { return aValue++; }
+    static TInt LockedDec(TInt &aValue) { return aValue--; }
+};
+
+class Mem
+{
+public:
+    static TUint8 *Copy(TAny *aTrg, const TAny *aSrc, TInt aLength) { memmove(aTrg, aSrc, aLength); return (TUint8 *)aTrg + aLength; }
+    static TUint8 *Move(TAny *aTrg, const TAny *aSrc, TInt aLength) { return Copy(aTrg, aSrc, aLength); }
+    static void Fill(TAny *aTrg, TInt aLength, TChar aChar) { memset(aTrg, (int)aChar, aLength); }
+    static void FillZ(TAny *aTrg, TInt aLength) { memset(aTrg, 0, aLength); }
+    static TInt Compare(const TUint8 *aLeft, TInt aLeftL, const TUint8 *aRight, TInt aRightL);
+};
+
+/* Leaves are C++ exceptions on the host, TRAP unwinds the cleanup
+ * stack down to where it stood when the TRAP was entered. */
+class THostLeave
+{
+public:
+    THostLeave(TInt aReason) : iReason(aReason) {}
+    TInt iReason;
+};
+
+class THostTrap
+{
+public:
+    THostTrap();
+    TInt Unwind(TInt aReason);
+
+private:
+    TInt iMark;
+};
+
+#define TRAP(_r, _s)                                    \
+    {                                                   \
+        THostTrap __trap;                               \
+        try                                             \
+        {                                               \
+            _s;                                         \
+            _r = KErrNone;                              \
+        }                                               \
+        catch (const THostLeave &__leave)               \
+        {                                               \
+            _r = __trap.Unwind(__leave.iReason);        \
+        }                                               \
+    }
+
+#define TRAPD(_r, _s) TInt _r; TRAP(_r, _s)
+
+#define TRAP_IGNORE(_s) { TInt __ignore; TRAP(__ignore, _s); (void)__ignore; }
+
+/* ------------------------------------------------------------------ */
+/* Base classes                                                       */
+/* ------------------------------------------------------------------ */
+
+/* Like on the phone, objects are allocated zero filled. */
+class CBase
+{
+public:
+    virtual ~CBase();
+    static TAny *operator new(size_t aSize);
+    static TAny *operator new(size_t aSize, TLeave);
+    static void operator delete(TAny *aPtr);
+    static void operator delete(TAny *aPtr, TLeave);
+
+protected:
+    CBase();
+
+private:
+    CBase(const CBase &aBase);
+    CBase &operator=(const CBase &aBase);
+};
+
+class CleanupStack
+{
+public:
+    static void PushL(TAny *aPtr);
+    static void PushL(CBase *aPtr);
+    static void Pop();
+    static void Pop(TInt aCount);
+    static void Pop(TAny *aExpectedItem);
+    static void PopAndDestroy();
+    static void PopAndDestroy(TInt aCount);
+    static void PopAndDestroy(TAny *aExpectedItem);
+};
+
+class CTrapCleanup : public CBase
+{
+public:
+    static CTrapCleanup *New();
+};
+
+class CActive : public CBase
+{
+public:
+    enum TPriority
+    {
+        EPriorityIdle      = -100,
+        EPriorityLow       = -20,
+        EPriorityStandard  = 0,
+        EPriorityUserInput = 10,
+        EPriorityHigh      = 20
+    };
+
+    ~CActive();
+    void Cancel();
+    void Deque();
+    void SetPriority(TInt aPriority) { iPriority = aPriority; }
+    TInt Priority() const { return iPriority; }
+    TBool IsActive() const { return iActive; }
+    TBool IsAdded() const { return iAdded; }
+
+protected:
+    CActive(TInt aPriority);
+    void SetActive() { iActive = ETrue; }
+    virtual void DoCancel() = 0;
+    virtual void RunL() = 0;
+    virtual TInt RunError(TInt aError);
+
+public:
+    TRequestStatus iStatus;
+
+private:
+    friend class CActiveScheduler;
+    friend class CTimer;
+    TInt     iPriority;
+    TBool    iActive;
+    TBool    iAdded;
+    TTime    iDue;     ///< Host only: when a timer completes iStatus
+    TBool    iTiming;  ///< Host only: iDue is valid
+    CActive *iNext;
+};
+
+/* Start() is not available, the host tools run ready active objects
+ * and due timers with RunReady() instead. */
+class CActiveScheduler : public CBase
+{
+public:
+    static void Add(CActive *aActive);
+    static void Install(CActiveScheduler *aScheduler);
+    static CActiveScheduler *Current();
+    static void Stop();
+
+    /* Host only: runs active objects until none is ready, returns the
+     * number of RunL calls. */
+    static TInt RunReady();
+
+private:
+    friend class CActive;
+    static void Remove(CActive *aActive);
+};
+
+class CTimer : public CActive
+{
+public:
+    ~CTimer();
+    void After(TTimeIntervalMicroSeconds32 aInterval);
+
+protected:
+    CTimer(TInt aPriority);
+    void ConstructL();
+    void DoCancel();
+};
+
+class CPeriodic : public CTimer
+{
+public:
+    static CPeriodic *New(TInt aPriority);
+    static CPeriodic *NewL(TInt aPriority);
+    ~CPeriodic();
+    void Start(TTimeIntervalMicroSeconds32 aDelay, TTimeIntervalMicroSeconds32 aInterval, TCallBack aCallBack);
+
+protected:
+    CPeriodic(TInt aPriority);
+    void RunL();
+
+private:
+    TTimeIntervalMicroSeconds32 iInterval;
+    TCallBack                   iCallBack;
+};
+
+/* ------------------------------------------------------------------ */
+/* Host only                                                          */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Counters of the emulated heap, for the tools that check
+ *        where the library allocates.
+ */
+class HostHeap
+{
+public:
+    static TInt Allocs(); ///< Cells allocated so far
+    static TInt Cells();  ///< Cells allocated and not freed yet
+};
+
+#endif /* __E32HOST_H */
@@ -0,0 +1,66 @@
+/** @file es_sock.h
+ *
+ *  Host stand-in for the socket server API.  A connected socket is a
+ *  loopback to the hub side in HostLink.h: writes complete at once,
+ *  reads complete once the hub has sent something.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __ES_SOCK_H
+#define __ES_SOCK_H
+
+#include "e32host.h"
+
+typedef TBuf16<0x100> THostName;
+
+class TSockAddr
+{
+public:
+    TSockAddr() : iPort(0) {}
+    TUint Port() const { return iPort; }
+    void SetPort(TUint aPort) { iPort = aPort; }
+
+private:
+    TUint iPort;
+};
+
+class TSockXfrLength
+{
+public:
+    TSockXfrLength() : iLength(0) {}
+    TInt operator()() const { return iLength; }
+
+    TInt iLength;
+};
+
+class RSocketServ
+{
+public:
+    TInt Connect(TUint aMessageSlots = 8) { (void)aMessageSlots; return KErrNone; }
+    void Close() {}
+};
+
+class RSocket
+{
+public:
+    enum TShutdown { ENormal, EStopInput, EStopOutput, EImmediate };
+
+    RSocket() : iOpen(EFalse) {}
+    TInt Open(RSocketServ &aServer, const TDesC16 &aName);
+    void Connect(TSockAddr &aAddr, TRequestStatus &aStatus);
+    void Write(const TDesC8 &aDesc, TRequestStatus &aStatus);
+    void RecvOneOrMore(TDes8 &aDesc, TUint aFlags, TRequestStatus &aStatus, TSockXfrLength &aLen);
+    void CancelRead();
+    void CancelWrite() {}
+    void CancelAll() { CancelRead(); }
+    void Shutdown(TShutdown aHow, TRequestStatus &aStatus);
+    void Close();
+
+private:
+    TBool iOpen;
+};
+
+#endif /* __ES_SOCK_H */
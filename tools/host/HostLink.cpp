@@ -0,0 +1,517 @@
+/** @file HostLink.cpp
+ *
+ *  Host socket and the hub end of the host link, see HostLink.h.  The
+ *  decoding follows loop() in client/src/main.cpp step by step.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <es_sock.h>
+
+#include "HostLink.h"
+#include "codec.h"
+
+#define MAX_MESSAGE_LENGTH 512
+#define BLOCK_SIZE         512
+#define BATCH_SIZE         1024
+
+static MHostHubObserver *observer;
+static THostHubStats     stats;
+static TUint8            acceptMask = 0x07;
+static TInt              corruptOffset = -1;
+static TBool             decoding = ETrue;
+
+/* Hub state, see loop() */
+static char         buffer[MAX_MESSAGE_LENGTH];
+static unsigned int length_read;
+static bool         registered;
+static bool         offered;
+static uint8_t      accepted;
+static int          rxVersion;
+static uint8_t      device_capabilities;
+static char         batch[BATCH_SIZE];
+static unsigned int batch_length;
+static bool         overflow;
+
+/* Reads of the library */
+static TUint8          inbound[HostLink::KInboundSize];
+static TInt            inboundLength;
+static TDes8          *readBuffer;
+static TRequestStatus *readStatus;
+static TSockXfrLength *readLength;
+
+static void CompleteRead()
+{
+    TInt length;
+
+    if (! readStatus || (inboundLength == 0))
+    {
+        return;
+    }
+
+    length = Min(inboundLength, readBuffer->MaxLength());
+    readBuffer->Copy(inbound, length);
+    readLength->iLength = length;
+    memmove(inbound, &inbound[length], inboundLength - length);
+    inboundLength -= length;
+
+    *readStatus = KErrNone;
+    readStatus  = NULL;
+}
+
+static void Answer(const char *aData, TInt aLength)
+{
+    HostLink::Send(TPtrC8((const TUint8 *)aData, aLength));
+}
+
+/* Bytes in front of the payload of a protocol 2 frame */
+static unsigned int HeaderSize(const char *aFrame)
+{
+    unsigned int payload = (unsigned char)aFrame[1] & 0x7f;
+
+    if (aFrame[1] & 0x80)
+    {
+        payload |= (unsigned int)(unsigned char)aFrame[2] << 7;
+    }
+
+    return frame_size(aFrame, MAX_MESSAGE_LENGTH, device_capabilities) - payload;
+}
+
+static void handle_frame(const char *frame, unsigned int length)
+{
+    unsigned int header = HeaderSize(frame);
+
+    if ((frame[0] & 0x27) == 0x00)
+    {
+        return; /* Superseded or control frame */
+    }
+
+    stats.iFrames       += 1;
+    stats.iPayloadBytes += length - header;
+    if (observer)
+    {
+        observer->FrameReceived((const TUint8 *)frame, length, header);
+    }
+}
+
+static void handle_frame_v1(const char *frame, unsigned int length)
+{
+    if ((frame[0] & 0x27) == 0x00)
+    {
+        return;
+    }
+
+    stats.iFrames       += 1;
+    stats.iPayloadBytes += length - 3;
+    if (observer)
+    {
+        observer->FrameReceived((const TUint8 *)frame, length - 1, 2);
+    }
+}
+
+static void handle_block(const char *frame, unsigned int length)
+{
+    char         block[BLOCK_SIZE];
+    unsigned int header_size = (frame[1] & 0x80) ? 3 : 2;
+    int          size;
+
+    size = lz_decompress((const uint8_t *)&frame[header_size], length - header_size, (uint8_t *)block, sizeof(block));
+    if (size < 0)
+    {
+        stats.iCorruptBlocks += 1;
+        return;
+    }
+
+    stats.iBlocks += 1;
+    for (unsigned int offset = 0; offset < (unsigned int)size;)
+    {
+        unsigned int size_of = frame_size(&block[offset], size - offset, device_capabilities);
+
+        if (size_of == 0 || offset + size_of > (unsigned int)size)
+        {
+            break;
+        }
+        handle_frame(&block[offset], size_of);
+        offset += size_of;
+    }
+}
+
+static void put_le32(char *aBuffer, uint32_t aValue)
+{
+    aBuffer[0] = (char)(aValue & 0xff);
+    aBuffer[1] = (char)((aValue >> 8) & 0xff);
+    aBuffer[2] = (char)((aValue >> 16) & 0xff);
+    aBuffer[3] = (char)(aValue >> 24);
+}
+
+static uint32_t micros()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_usec);
+}
+
+static void answer_clock(const char *frame, uint32_t received)
+{
+    char         answer[19] = { 0x00, 0x0d, 'T' };
+    unsigned int length     = 15;
+
+    memcpy(&answer[3], &frame[3], 4);
+    put_le32(&answer[7], received);
+    put_le32(&answer[11], micros());
+
+    if (device_capabilities & 0x02)
+    {
+        uint16_t crc = crc16(answer, length);
+
+        answer[length++] = 0x07;
+        answer[length++] = 0x02;
+        answer[length++] = (char)(crc & 0xff);
+        answer[length++] = (char)(crc >> 8);
+    }
+
+    Answer(answer, length);
+}
+
+static void dispatch(const char *frame, unsigned int length)
+{
+    if ((frame[0] & 0x27) == 0x06)
+    {
+        handle_block(frame, length);
+    }
+    else if (frame[0] == 0x00 && length == 7 && frame[2] == 'T')
+    {
+        answer_clock(frame, micros());
+    }
+    else
+    {
+        handle_frame(frame, length);
+    }
+}
+
+static void handle_checked(const char *frame, unsigned int length)
+{
+    if ((frame[0] & 0x27) != 0x07)
+    {
+        if (batch_length + length > BATCH_SIZE)
+        {
+            overflow = true;
+        }
+        else
+        {
+            memcpy(&batch[batch_length], frame, length);
+            batch_length += length;
+        }
+        return;
+    }
+
+    if (! overflow && length == 4 &&
+        crc16(batch, batch_length) == (uint16_t)((uint8_t)frame[2] | ((uint8_t)frame[3] << 8)))
+    {
+        stats.iBatches += 1;
+        for (unsigned int offset = 0; offset < batch_length;)
+        {
+            unsigned int size = frame_size(&batch[offset], batch_length - offset, device_capabilities);
+
+            if (size == 0 || offset + size > batch_length)
+            {
+                break;
+            }
+            dispatch(&batch[offset], size);
+            offset += size;
+        }
+    }
+    else
+    {
+        stats.iCorruptBatches += 1;
+    }
+
+    batch_length = 0;
+    overflow     = false;
+}
+
+static bool is_upgrade(const char *frame, unsigned int length)
+{
+    return length == 5 && frame[0] == 0x00 && frame[2] == 'V' && frame[3] == 0x02;
+}
+
+static void accept_protocol()
+{
+    if (offered)
+    {
+        const char ack[] = { 0x00, 0x03, 'V', 0x02, (char)accepted, '\n' };
+
+        Answer(ack, sizeof(ack));
+        device_capabilities = accepted;
+    }
+}
+
+static bool register_frame(const char *frame, unsigned int length)
+{
+    const uint8_t *data = (const uint8_t *)frame;
+    unsigned int   name;
+    unsigned int   host;
+
+    if (length < 16 || data[2] != 'R' || data[3] != 0x01 || data[length - 1] != '\n')
+    {
+        return false;
+    }
+
+    name = data[13];
+    if (14 + name >= length - 1)
+    {
+        return false;
+    }
+    host = data[14 + name];
+    if (15 + name + host != length - 1)
+    {
+        return false;
+    }
+
+    offered  = data[9] >= 2;
+    accepted = data[10] & acceptMask;
+
+    return true;
+}
+
+static void HubByte(char aByte)
+{
+    if (length_read < MAX_MESSAGE_LENGTH - 1)
+    {
+        buffer[length_read] = aByte;
+        length_read += 1;
+    }
+
+    if (! registered && buffer[0] == 0x00)
+    {
+        if (length_read >= 2 && length_read == (unsigned int)(unsigned char)buffer[1] + 3)
+        {
+            if (! register_frame(buffer, length_read))
+            {
+                length_read = 0;
+                return;
+            }
+            registered = true;
+            length_read      = 0;
+
+            const char ack[] = { 0x00, 0x02, 'R', 0x01, '\n' };
+
+            Answer(ack, sizeof(ack));
+            accept_protocol();
+        }
+    }
+    else if (! registered)
+    {
+        if (aByte == '\n' || length_read == MAX_MESSAGE_LENGTH - 1)
+        {
+            buffer[length_read - 1] = '\0';
+
+            if (strncmp(buffer, "PRO:", 4) == 0 && atoi(&buffer[4]) >= 2)
+            {
+                const char *capabilities = strchr(&buffer[4], ':');
+
+                offered = true;
+                if (capabilities)
+                {
+                    accepted = strtol(&capabilities[1], NULL, 16) & acceptMask;
+                }
+            }
+            else if (strncmp(buffer, "ROL:", 4) == 0)
+            {
+                registered = true;
+                accept_protocol();
+            }
+            length_read = 0;
+        }
+    }
+    else if (rxVersion == 1)
+    {
+        if (length_read >= 2 && length_read == (unsigned int)(unsigned char)buffer[1] + 3)
+        {
+            if (buffer[length_read - 1] == '\n')
+            {
+                if (is_upgrade(buffer, length_read))
+                {
+                    rxVersion = 2;
+                }
+                else
+                {
+                    handle_frame_v1(buffer, length_read);
+                }
+                length_read = 0;
+            }
+            else
+            {
+                memmove(buffer, &buffer[1], length_read - 1);
+                length_read -= 1;
+            }
+        }
+    }
+    else
+    {
+        unsigned int size = frame_size(buffer, length_read, device_capabilities);
+
+        if (size > MAX_MESSAGE_LENGTH - 1)
+        {
+            memmove(buffer, &buffer[1], length_read - 1);
+            length_read -= 1;
+        }
+        else if (size > 0 && length_read == size)
+        {
+            if (accepted & 0x02)
+            {
+                handle_checked(buffer, length_read);
+            }
+            else
+            {
+                dispatch(buffer, length_read);
+            }
+            length_read = 0;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+
+void HostLink::SetAccepted(TUint8 aCapabilities)
+{
+    acceptMask = aCapabilities;
+}
+
+void HostLink::SetObserver(MHostHubObserver *aObserver)
+{
+    observer = aObserver;
+}
+
+void HostLink::CorruptNextWrite(TInt aOffset)
+{
+    corruptOffset = aOffset;
+}
+
+void HostLink::SetDecoding(TBool aDecoding)
+{
+    decoding = aDecoding;
+}
+
+void HostLink::Send(const TDesC8 &aData)
+{
+    if (inboundLength + aData.Length() > KInboundSize)
+    {
+        fprintf(stderr, "HostLink: %d bytes for the library do not fit\n", aData.Length());
+        abort();
+    }
+
+    memcpy(&inbound[inboundLength], aData.Ptr(), aData.Length());
+    inboundLength += aData.Length();
+
+    CompleteRead();
+}
+
+TBool HostLink::Registered()
+{
+    return registered;
+}
+
+TInt HostLink::Version()
+{
+    return rxVersion;
+}
+
+const THostHubStats &HostLink::Stats()
+{
+    return stats;
+}
+
+void HostLink::ResetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* ------------------------------------------------------------------ */
+
+TInt RSocket::Open(RSocketServ & /*aServer*/, const TDesC16 & /*aName*/)
+{
+    /* A new connection, the hub starts over. */
+    length_read               = 0;
+    registered          = false;
+    offered             = false;
+    accepted            = 0;
+    rxVersion           = 1;
+    device_capabilities = 0;
+    batch_length        = 0;
+    overflow            = false;
+    inboundLength       = 0;
+    readStatus          = NULL;
+    memset(buffer, 0, sizeof(buffer));
+    HostLink::ResetStats();
+
+    iOpen = ETrue;
+
+    return KErrNone;
+}
+
+void RSocket::Connect(TSockAddr & /*aAddr*/, TRequestStatus &aStatus)
+{
+    aStatus = KErrNone;
+}
+
+void RSocket::Write(const TDesC8 &aDesc, TRequestStatus &aStatus)
+{
+    stats.iWrites       += 1;
+    stats.iBytesWritten += aDesc.Length();
+
+    for (TInt offset = 0; decoding && (offset < aDesc.Length()); offset += 1)
+    {
+        char byte = (char)aDesc[offset];
+
+        if (offset == corruptOffset)
+        {
+            byte          ^= 0xff;
+            corruptOffset  = -1;
+        }
+        HubByte(byte);
+    }
+    corruptOffset = -1;
+
+    aStatus = iOpen ? KErrNone : KErrDisconnected;
+}
+
+void RSocket::RecvOneOrMore(TDes8 &aDesc, TUint /*aFlags*/, TRequestStatus &aStatus, TSockXfrLength &aLen)
+{
+    readBuffer = &aDesc;
+    readLength = &aLen;
+    readStatus = &aStatus;
+    aStatus    = KRequestPending;
+
+    CompleteRead();
+}
+
+void RSocket::CancelRead()
+{
+    if (readStatus)
+    {
+        *readStatus = KErrCancel;
+        readStatus  = NULL;
+    }
+}
+
+void RSocket::Shutdown(TShutdown /*aHow*/, TRequestStatus &aStatus)
+{
+    CancelRead();
+    aStatus = KErrNone;
+}
+
+void RSocket::Close()
+{
+    CancelRead();
+    iOpen = EFalse;
+}
@@ -0,0 +1,155 @@
+/** @file HostLink.h
+ *
+ *  Hub end of the host link.  Whatever the library writes to its
+ *  socket is decoded here the way client/src/main.cpp decodes it on
+ *  the ESP32, sharing the hub's codec in client/include/codec.h.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __HOSTLINK_H
+#define __HOSTLINK_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+/**
+ * @brief Receives every frame the hub decoded, after compressed
+ *        blocks were expanded and CRC batches were checked.
+ */
+class MHostHubObserver
+{
+public:
+    /**
+     * @name  FrameReceived
+     *
+     * @fn    void FrameReceived(const TUint8* aFrame, TInt aLength, TInt aHeaderSize)
+     *
+     * @param aFrame      The frame, starting with its header byte
+     * @param aLength     Length of the frame including its header
+     * @param aHeaderSize Bytes in front of the payload: header,
+     *                    length, channel and stamp
+     */
+    virtual void FrameReceived(const TUint8 *aFrame, TInt aLength, TInt aHeaderSize) = 0;
+};
+
+/**
+ * @brief Counters of the hub end, reset when the library opens a
+ *        new socket.
+ */
+typedef struct
+{
+    TInt iWrites;         ///< Writes issued by the library
+    TInt iBytesWritten;   ///< Bytes the library wrote
+    TInt iFrames;         ///< Frames passed to the observer
+    TInt iPayloadBytes;   ///< Payload bytes of those frames
+    TInt iBlocks;         ///< Compressed blocks expanded
+    TInt iCorruptBlocks;  ///< Compressed blocks that did not expand
+    TInt iBatches;        ///< CRC batches that passed the check
+    TInt iCorruptBatches; ///< CRC batches dropped
+
+} THostHubStats;
+
+/**
+ * @name  Class HostLink
+ *
+ * @class HostLink
+ *
+ * @brief Controls the hub end of the single host link.
+ *
+ *        The hub accepts the registration and protocol 2 with the
+ *        offered capabilities masked by SetAccepted().  Writes of the
+ *        library complete at once, reads complete once Send() has
+ *        queued something.
+ */
+class HostLink
+{
+public:
+    enum
+    {
+        KInboundSize = 0x10000 ///< Bytes Send() can queue for the library
+    };
+
+    /**
+     * @name  SetAccepted
+     *
+     * @fn    static void SetAccepted(TUint8 aCapabilities)
+     *
+     * @brief Capabilities the hub accepts if offered, all by default.
+     */
+    static void SetAccepted(TUint8 aCapabilities);
+
+    /**
+     * @name  SetObserver
+     *
+     * @fn    static void SetObserver(MHostHubObserver* aObserver)
+     *
+     * @param aObserver Receives the decoded frames, may be NULL
+     */
+    static void SetObserver(MHostHubObserver *aObserver);
+
+    /**
+     * @name  CorruptNextWrite
+     *
+     * @fn    static void CorruptNextWrite(TInt aOffset)
+     *
+     * @brief Flips the bits of byte aOffset of the next write on its
+     *        way to the hub, as a noisy serial line would.
+     */
+    static void CorruptNextWrite(TInt aOffset);
+
+    /**
+     * @name  SetDecoding
+     *
+     * @fn    static void SetDecoding(TBool aDecoding)
+     *
+     * @brief With EFalse, writes are only counted, so that a benchmark
+     *        times the library alone.  On by default.
+     */
+    static void SetDecoding(TBool aDecoding);
+
+    /**
+     * @name  Send
+     *
+     * @fn    static void Send(const TDesC8& aData)
+     *
+     * @brief Queues data from the hub for the library.
+     */
+    static void Send(const TDesC8 &aData);
+
+    /**
+     * @name  Registered
+     *
+     * @fn    static TBool Registered()
+     *
+     * @return ETrue once the hub has accepted a registration.
+     */
+    static TBool Registered();
+
+    /**
+     * @name  Version
+     *
+     * @fn    static TInt Version()
+     *
+     * @return Protocol the hub reads from the library.
+     */
+    static TInt Version();
+
+    /**
+     * @name  Stats
+     *
+     * @fn    static const THostHubStats& Stats()
+     */
+    static const THostHubStats &Stats();
+
+    /**
+     * @name  ResetStats
+     *
+     * @fn    static void ResetStats()
+     */
+    static void ResetStats();
+};
+
+#endif /* __HOSTLINK_H */
@@ -0,0 +1,39 @@
+/** @file HostServiceSearcher.cpp
+ *
+ *  Host stand-in for CMessageServiceSearcher, see MessageServiceSearcher.h.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include "MessageServiceSearcher.h"
+
+CMessageServiceSearcher *CMessageServiceSearcher::NewL()
+{
+    return new (ELeave) CMessageServiceSearcher;
+}
+
+CMessageServiceSearcher::~CMessageServiceSearcher()
+{
+}
+
+void CMessageServiceSearcher::SelectDeviceByDiscoveryL(TRequestStatus &aObserverRequestStatus)
+{
+    aObserverRequestStatus = KErrNone;
+}
+
+void CMessageServiceSearcher::FindServiceL(TRequestStatus &aObserverRequestStatus)
+{
+    aObserverRequestStatus = KErrNone;
+}
+
+const TBTDevAddr &CMessageServiceSearcher::BTDevAddr()
+{
+    return iDevAddr;
+}
+
+TInt CMessageServiceSearcher::Port()
+{
+    return 1;
+}
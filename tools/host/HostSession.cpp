@@ -0,0 +1,164 @@
+/** @file HostSession.cpp
+ *
+ *  Helpers shared by the host tools, see HostSession.h.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "HostLink.h"
+#include "HostSession.h"
+
+enum
+{
+    KStartTimeout = 1000000 ///< Time in us the hub has to take the registration
+};
+
+THostNotify::THostNotify()
+: iStarted(0),
+  iReceived(0),
+  iReceivedBytes(0)
+{
+}
+
+void THostNotify::ClientConnected(TUint16 /*aClientId*/, TDesC & /*aClientName*/, TInt /*aError*/)
+{
+}
+
+void THostNotify::HostSelected(TInt /*aError*/)
+{
+}
+
+void THostNotify::HostConnected(TInt /*aError*/)
+{
+}
+
+void THostNotify::StartMultiPlayerGame(TInt aError)
+{
+    if (aError == KErrNone)
+    {
+        iStarted += 1;
+    }
+}
+
+void THostNotify::ContinueMultiPlayerGame()
+{
+}
+
+void THostNotify::PauseMultiPlayerGame()
+{
+}
+
+void THostNotify::EndMultiPlayerGame(TInt /*aReason*/)
+{
+}
+
+void THostNotify::ConnectedClientEndedGame(TUint16 /*aClientId*/)
+{
+}
+
+void THostNotify::ClientDisconnected(TUint16 /*aClientId*/, TInt /*aError*/)
+{
+}
+
+void THostNotify::HostDisconnected(TInt /*aError*/)
+{
+}
+
+void THostNotify::ReceiveDataFromClient(TUint16 /*aClientId*/, TDesC8 &aData)
+{
+    iReceived      += 1;
+    iReceivedBytes += aData.Length();
+}
+
+void THostNotify::ReceiveDataFromHost(TDesC8 &aData)
+{
+    iReceived      += 1;
+    iReceivedBytes += aData.Length();
+}
+
+void HostWriteIni(const char *aContents)
+{
+    FILE *file = fopen("E:\\GameComms.ini", "w");
+
+    if (! file)
+    {
+        User::Leave(KErrGeneral);
+    }
+
+    fputs(aContents, file);
+    fclose(file);
+}
+
+void HostSpin(TInt aTime)
+{
+    TTime end;
+    TTime now;
+
+    end.HomeTime();
+    end += TTimeIntervalMicroSeconds32(aTime);
+
+    do
+    {
+        if (CActiveScheduler::RunReady() == 0)
+        {
+            usleep(100);
+        }
+        now.HomeTime();
+    } while (now < end);
+}
+
+CGameBTComms *HostStartL(THostNotify &aNotify)
+{
+    CGameBTComms *comms = CGameBTComms::NewL(&aNotify, 0x101f5ee2);
+    TTime         end;
+    TTime         now;
+
+    CleanupStack::PushL(comms);
+
+    /* Device selection, service search and connection */
+    CActiveScheduler::RunReady();
+
+    comms->StartHostL(4, 2);
+
+    end.HomeTime();
+    end += TTimeIntervalMicroSeconds32(KStartTimeout);
+    while (aNotify.iStarted == 0)
+    {
+        HostSpin(1000);
+        comms->Pump();
+
+        now.HomeTime();
+        if (now > end)
+        {
+            User::Leave(KErrTimedOut);
+        }
+    }
+
+    CleanupStack::Pop(comms);
+
+    return comms;
+}
+
+int HostMain(void (*aMainL)())
+{
+    CTrapCleanup     *cleanup   = CTrapCleanup::New();
+    CActiveScheduler *scheduler = new CActiveScheduler;
+
+    CActiveScheduler::Install(scheduler);
+
+    TRAPD(error, aMainL());
+    if (error != KErrNone)
+    {
+        printf("Left with %d\n", error);
+    }
+
+    delete scheduler;
+    delete cleanup;
+
+    return (error == KErrNone) ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/** @file HostSession.h
+ *
+ *  Helpers shared by the host tools: a game that counts what the
+ *  library reports, the ini file and a session with the hub end of
+ *  the host link.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __HOSTSESSION_H
+#define __HOSTSESSION_H
+
+#include <e32base.h>
+#include <e32std.h>
+
+#include "GameBTComms.h"
+#include "GameBTCommsNotify.h"
+
+/**
+ * @brief Game side of a host tool, counts the notifications.
+ */
+class THostNotify : public MGameBTCommsNotify
+{
+public:
+    THostNotify();
+
+    void ClientConnected(TUint16 aClientId, TDesC &aClientName, TInt aError);
+    void HostSelected(TInt aError);
+    void HostConnected(TInt aError);
+    void StartMultiPlayerGame(TInt aError);
+    void ContinueMultiPlayerGame();
+    void PauseMultiPlayerGame();
+    void EndMultiPlayerGame(TInt aReason);
+    void ConnectedClientEndedGame(TUint16 aClientId);
+    void ClientDisconnected(TUint16 aClientId, TInt aError);
+    void HostDisconnected(TInt aError);
+    void ReceiveDataFromClient(TUint16 aClientId, TDesC8 &aData);
+    void ReceiveDataFromHost(TDesC8 &aData);
+
+public:
+    TInt iStarted;       ///< StartMultiPlayerGame() calls
+    TInt iReceived;      ///< Messages received
+    TInt iReceivedBytes; ///< Bytes of those messages
+};
+
+/**
+ * @name  HostWriteIni
+ *
+ * @fn    void HostWriteIni(const char* aContents)
+ *
+ * @brief Writes the ini file CGameBTComms::NewL() reads, replacing
+ *        any earlier one.
+ */
+void HostWriteIni(const char *aContents);
+
+/**
+ * @name  HostSpin
+ *
+ * @fn    void HostSpin(TInt aTime)
+ *
+ * @brief Runs the active objects for aTime us, as the game's active
+ *        scheduler would.
+ */
+void HostSpin(TInt aTime);
+
+/**
+ * @name  HostStartL
+ *
+ * @fn    CGameBTComms* HostStartL(THostNotify& aNotify)
+ *
+ * @brief Creates the library, connects it to the hub end of the host
+ *        link and starts a game as host.  Leaves with KErrTimedOut if
+ *        the hub does not take the registration.
+ *
+ * @return The library, owned by the caller.
+ */
+CGameBTComms *HostStartL(THostNotify &aNotify);
+
+/**
+ * @name  HostMain
+ *
+ * @fn    int HostMain(void (*aMainL)())
+ *
+ * @brief Sets up the cleanup stack and the active scheduler and runs
+ *        aMainL.
+ *
+ * @return Exit code of the tool, 1 if aMainL left.
+ */
+int HostMain(void (*aMainL)());
+
+#endif /* __HOSTSESSION_H */
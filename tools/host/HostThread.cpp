@@ -0,0 +1,18 @@
+/** @file HostThread.cpp
+ *
+ *  Threads are not emulated on the host, so enabling [Thread] in the
+ *  ini file makes CGameBTComms::NewL() leave with KErrNotSupported.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include "GameBTCommsThread.h"
+
+CGameBTCommsThread *CGameBTCommsThread::NewL(MMessageClientObserver * /*aObserver*/, TInt /*aRingSize*/, TInt /*aMaxWrite*/, TInt /*aInterval*/)
+{
+    User::Leave(KErrNotSupported);
+
+    return NULL;
+}
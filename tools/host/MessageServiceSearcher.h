@@ -0,0 +1,33 @@
+/** @file MessageServiceSearcher.h
+ *
+ *  Host stand-in for the service searcher in include/Bluetooth.  The
+ *  host link has a single remote device, so device selection and the
+ *  service search complete at once.
+ *
+ *  Copyright (c) 2023, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef __MESSAGESERVICESEARCHER_H__
+#define __MESSAGESERVICESEARCHER_H__
+
+#include <e32base.h>
+#include <bttypes.h>
+
+class CMessageServiceSearcher : public CBase
+{
+public:
+    static CMessageServiceSearcher *NewL();
+    ~CMessageServiceSearcher();
+
+    void SelectDeviceByDiscoveryL(TRequestStatus &aObserverRequestStatus);
+    void FindServiceL(TRequestStatus &aObserverRequestStatus);
+    const TBTDevAddr &BTDevAddr();
+    TInt Port();
+
+private:
+    TBTDevAddr iDevAddr; ///< Always the host link
+};
+
+#endif /* __MESSAGESERVICESEARCHER_H__ */